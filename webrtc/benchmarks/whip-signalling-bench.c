@@ -0,0 +1,125 @@
+/* GStreamer
+ * Copyright (C) 2022 Taruntej Kanakamalla <taruntej@asymptotic.io>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* Microbenchmarks of the WHIP signalling core, run with meson test
+ * --benchmark or directly as whip-signalling-bench [iterations] */
+
+#include <stdlib.h>
+
+#include "gstwhipsignalling.h"
+
+#define DEFAULT_ITERATIONS 100000
+
+static const gchar *link_header =
+    "<stun:stun.example.net>; rel=\"ice-server\", "
+    "<turn:turn.example.net?transport=udp>; rel=\"ice-server\"; "
+    "username=\"user\"; credential=\"myPassword\"; "
+    "credential-type=\"password\", "
+    "<turns:turn.example.net?transport=tcp>; rel=\"ice-server\"; "
+    "username=\"user\"; credential=\"myPassword\"; "
+    "credential-type: \"password\"";
+
+static const gchar *candidates[] = {
+  "candidate:1 1 UDP 2015363327 192.0.2.10 49203 typ host",
+  "candidate:2 1 UDP 1679819007 198.51.100.7 49203 typ srflx "
+      "raddr 192.0.2.10 rport 49203",
+  "candidate:3 1 TCP 1015021823 192.0.2.10 9 typ host tcptype active",
+  NULL
+};
+
+static guint n_sink;
+
+static void
+bench_parse_link_header (void)
+{
+  GPtrArray *servers = gst_whip_parse_link_header (link_header);
+  n_sink += servers->len;
+  g_ptr_array_unref (servers);
+}
+
+static void
+bench_resolve_url (void)
+{
+  gchar *url = gst_whip_resolve_url ("https://whip.example.net/whip/endpoint",
+      "../resource/1e0c2b4d-0d6a-4a5e-a2d8-d7d1e8b8c1b1");
+  n_sink += url != NULL;
+  g_free (url);
+}
+
+static void
+bench_build_trickle_sdpfrag (void)
+{
+  gchar *frag = gst_whip_build_trickle_sdpfrag ("EsAw",
+      "P2uYro0UCOQ4zxjKXaWCBui1", "0", 0, candidates, TRUE);
+  n_sink += frag[0];
+  g_free (frag);
+}
+
+static void
+bench_state_machine (void)
+{
+  GstWhipSignallingState state = GST_WHIP_SIGNALLING_STATE_NEW;
+
+  gst_whip_signalling_state_transition (&state,
+      GST_WHIP_SIGNALLING_EVENT_OPTIONS_SENT);
+  gst_whip_signalling_state_transition (&state,
+      GST_WHIP_SIGNALLING_EVENT_OFFER_SENT);
+  gst_whip_signalling_state_transition (&state,
+      GST_WHIP_SIGNALLING_EVENT_ANSWER_RECEIVED);
+  gst_whip_signalling_state_transition (&state,
+      GST_WHIP_SIGNALLING_EVENT_TERMINATE);
+  gst_whip_signalling_state_transition (&state,
+      GST_WHIP_SIGNALLING_EVENT_TERMINATED);
+  n_sink += state;
+}
+
+static void
+run (const gchar * name, void (*func) (void), guint iterations)
+{
+  gint64 start, elapsed;
+  guint i;
+
+  //warm up
+  for (i = 0; i < iterations / 10; i++)
+    func ();
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < iterations; i++)
+    func ();
+  elapsed = g_get_monotonic_time () - start;
+
+  g_print ("%-24s %10u iterations %10.1f ns/op\n", name, iterations,
+      elapsed * 1000.0 / iterations);
+}
+
+int
+main (int argc, char *argv[])
+{
+  guint iterations = DEFAULT_ITERATIONS;
+
+  if (argc > 1)
+    iterations = MAX (1, strtoul (argv[1], NULL, 10));
+
+  run ("parse-link-header", bench_parse_link_header, iterations);
+  run ("resolve-url", bench_resolve_url, iterations);
+  run ("build-trickle-sdpfrag", bench_build_trickle_sdpfrag, iterations);
+  run ("state-machine", bench_state_machine, iterations);
+
+  return n_sink == 0;
+}
@@ -0,0 +1,45 @@
+/* GStreamer
+ * Copyright (C) 2022 Taruntej Kanakamalla <taruntej@asymptotic.io>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* libFuzzer target for the parsing of untrusted WHIP server responses */
+
+#include <stdint.h>
+
+#include "gstwhipsignalling.h"
+
+int LLVMFuzzerTestOneInput (const uint8_t * data, size_t size);
+
+int
+LLVMFuzzerTestOneInput (const uint8_t * data, size_t size)
+{
+  gchar *input = g_strndup ((const gchar *) data, size);
+  GPtrArray *servers;
+  gchar *url;
+
+  servers = gst_whip_parse_link_header (input);
+  g_ptr_array_unref (servers);
+
+  //a Location header
+  url = gst_whip_resolve_url ("https://whip.example.net/whip/endpoint",
+      input);
+  g_free (url);
+
+  g_free (input);
+  return 0;
+}
@@ -26,6 +26,8 @@
  *
  */
 
+#include "gstwhepsrc.h"
+#include "gstwhipcommon.h"
 #include "gstwhipsink.h"
 #ifndef VERSION
 #define VERSION "0.0.1"
@@ -38,9 +40,15 @@
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
+  GST_DEBUG_CATEGORY_INIT (gst_whip_common_debug, "whipcommon", 0,
+      "WHIP/WHEP signalling");
 
-  return gst_element_register (plugin, "whipsink", GST_RANK_NONE,
-      GST_TYPE_WHIP_SINK);
+  if (!gst_element_register (plugin, "whipsink", GST_RANK_NONE,
+          GST_TYPE_WHIP_SINK))
+    return FALSE;
+
+  return gst_element_register (plugin, "whepsrc", GST_RANK_NONE,
+      GST_TYPE_WHEP_SRC);
 }
 
 
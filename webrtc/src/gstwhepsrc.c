@@ -0,0 +1,615 @@
+/* GStreamer
+ * Copyright (C) 2022 Taruntej Kanakamalla <taruntej@asymptotic.io>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+
+/**
+ * SECTION:element-gstwhepsrc
+ *
+ * The whepsrc element wraps the functionality of webrtcbin and adds the
+ * HTTP signalling of the WebRTC-HTTP egress protocol (WHEP) to play back
+ * a stream from a WHEP server. It exposes one RTP src pad per received
+ * track.
+ *
+ * The offer and the optional OPTIONS request for the ICE servers are sent
+ * asynchronously, the application needs to run the default main loop.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch-1.0 whepsrc whep-endpoint="http://localhost:7080/whep/endpoint/abc123" ! rtpvp8depay ! vp8dec ! videoconvert ! autovideosink
+ * ]|
+ * </refsect2>
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <string.h>
+
+#include "gstwhepsrc.h"
+#include "gstwhipcommon.h"
+
+GST_DEBUG_CATEGORY_STATIC (gst_whep_src_debug_category);
+#define GST_CAT_DEFAULT gst_whep_src_debug_category
+
+#define GST_WHEP_SRC_LOCK(s) g_mutex_lock(&(s)->lock)
+#define GST_WHEP_SRC_UNLOCK(s) g_mutex_unlock(&(s)->lock)
+
+#define DEFAULT_LATENCY 100
+#define DEFAULT_DROP_ON_LATENCY TRUE
+#define DEFAULT_DO_NACK TRUE
+#define DEFAULT_AUDIO_CAPS "application/x-rtp,media=audio,encoding-name=OPUS," \
+    "payload=111,clock-rate=48000"
+#define DEFAULT_VIDEO_CAPS "application/x-rtp,media=video,encoding-name=VP8," \
+    "payload=96,clock-rate=90000; application/x-rtp,media=video," \
+    "encoding-name=H264,payload=102,clock-rate=90000," \
+    "packetization-mode=(string)1,profile-level-id=(string)42e01f"
+
+/* prototypes */
+
+#define gst_whep_src_parent_class parent_class
+
+static void gst_whep_src_set_property (GObject * object,
+    guint property_id, const GValue * value, GParamSpec * pspec);
+static void gst_whep_src_get_property (GObject * object,
+    guint property_id, GValue * value, GParamSpec * pspec);
+static void gst_whep_src_dispose (GObject * object);
+static void gst_whep_src_finalize (GObject * object);
+static GstStateChangeReturn gst_whep_src_change_state (GstElement * element,
+    GstStateChange transition);
+static void gst_whep_src_deep_element_added (GstBin * bin, GstBin * sub_bin,
+    GstElement * element);
+
+/* pad templates */
+
+static GstStaticPadTemplate gst_whep_src_src_template =
+GST_STATIC_PAD_TEMPLATE ("src_%u",
+    GST_PAD_SRC,
+    GST_PAD_SOMETIMES,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
+
+enum
+{
+  PROP_0,
+  PROP_WHEP_ENDPOINT,
+  PROP_STUN_SERVER,
+  PROP_TURN_SERVER,
+  PROP_BUNDLE_POLICY,
+  PROP_USE_LINK_HEADERS,
+  PROP_LATENCY,
+  PROP_DROP_ON_LATENCY,
+  PROP_DO_NACK,
+  PROP_AUDIO_CAPS,
+  PROP_VIDEO_CAPS,
+};
+
+static void
+_on_answer_received (SoupMessage * msg, const gchar * body, gpointer userdata)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (userdata);
+  guint status = gst_whip_soup_get_status (msg);
+  GstWebRTCSessionDescription *answer;
+  GstSDPMessage *sdp_msg;
+
+  GST_DEBUG_OBJECT (whepsrc, "msg status %u \n%s", status, body);
+  if (status != 201 || body == NULL) {
+    GST_ELEMENT_ERROR (whepsrc, RESOURCE, FAILED, (NULL),
+        ("WHEP server replied to the offer with [%u] %s", status,
+            status ? gst_whip_soup_get_reason_phrase (msg) : "HTTP error"));
+    goto out;
+  }
+
+  const char *location =
+      soup_message_headers_get_one (gst_whip_soup_get_response_headers
+      (msg), "location");
+  if (location != NULL) {
+    GST_WHEP_SRC_LOCK (whepsrc);
+    g_free (whepsrc->resource_url);
+    whepsrc->resource_url =
+        gst_whip_resolve_url (whepsrc->whep_endpoint, location);
+    GST_DEBUG_OBJECT (whepsrc, "resource url is %s", whepsrc->resource_url);
+    GST_WHEP_SRC_UNLOCK (whepsrc);
+  }
+
+  if (gst_sdp_message_new_from_text (body, &sdp_msg) != GST_SDP_OK) {
+    GST_ELEMENT_ERROR (whepsrc, STREAM, DECODE, (NULL),
+        ("Could not parse the SDP answer"));
+    goto out;
+  }
+  answer = gst_webrtc_session_description_new (GST_WEBRTC_SDP_TYPE_ANSWER,
+      sdp_msg);
+  g_signal_emit_by_name (whepsrc->webrtcbin, "set-remote-description", answer,
+      NULL);
+  gst_webrtc_session_description_free (answer);
+
+out:
+  gst_object_unref (whepsrc);
+}
+
+static void
+_on_offer_created (GstPromise * promise, gpointer userdata)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (userdata);
+  if (gst_promise_wait (promise) == GST_PROMISE_RESULT_REPLIED) {
+    GstWebRTCSessionDescription *offer;
+    const GstStructure *reply;
+    SoupMessage *msg;
+    gchar *text;
+
+    reply = gst_promise_get_reply (promise);
+    gst_structure_get (reply, "offer", GST_TYPE_WEBRTC_SESSION_DESCRIPTION,
+        &offer, NULL);
+    gst_promise_unref (promise);
+    g_signal_emit_by_name (whepsrc->webrtcbin, "set-local-description", offer,
+        NULL);
+
+    text = gst_sdp_message_as_text (offer->sdp);
+    GST_DEBUG_OBJECT (whepsrc, "...\n%s", text);
+    gst_webrtc_session_description_free (offer);
+
+    GST_WHEP_SRC_LOCK (whepsrc);
+    msg = soup_message_new ("POST", whepsrc->whep_endpoint);
+    GST_WHEP_SRC_UNLOCK (whepsrc);
+    if (msg == NULL) {
+      GST_ELEMENT_ERROR (whepsrc, RESOURCE, NOT_FOUND, (NULL),
+          ("Invalid whep-endpoint"));
+      g_free (text);
+      return;
+    }
+    gst_whip_soup_set_request_body (msg, "application/sdp", text);
+    gst_whip_soup_send_async (whepsrc->soup_session, msg,
+        _on_answer_received, gst_object_ref (whepsrc));
+  }
+}
+
+static void
+_create_offer (GstWhepSrc * whepsrc)
+{
+  GstPromise *promise = gst_promise_new_with_change_func (_on_offer_created,
+      (gpointer) whepsrc,
+      NULL);
+  g_signal_emit_by_name ((gpointer) whepsrc->webrtcbin, "create-offer", NULL,
+      promise);
+}
+
+static void
+_http_options_response_callback (SoupMessage * msg,
+    const gchar * body G_GNUC_UNUSED, gpointer userdata)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (userdata);
+  guint status = gst_whip_soup_get_status (msg);
+  if (status != 200 && status != 204) {
+    GST_DEBUG_OBJECT (whepsrc, " [%u] %s\n\n", status,
+        status ? gst_whip_soup_get_reason_phrase (msg) : "HTTP error");
+  } else {
+    GST_INFO_OBJECT (whepsrc, "Updating ice servers from OPTIONS response");
+    const gchar *link_header =
+        soup_message_headers_get_list (gst_whip_soup_get_response_headers
+        (msg), "link");
+    if (link_header) {
+      GST_DEBUG_OBJECT (whepsrc, "link headers :%s", link_header);
+      gst_whip_update_ice_servers (whepsrc->webrtcbin, link_header);
+    }
+  }
+
+  //an OPTIONS failure only means no ice-servers from the server
+  _create_offer (whepsrc);
+  gst_object_unref (whepsrc);
+}
+
+static void
+_on_negotiation_needed (GstElement * webrtcbin, gpointer user_data)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (user_data);
+  GST_DEBUG_OBJECT (whepsrc, " whepsrc: %p...webrtcbin :%p \n", whepsrc,
+      webrtcbin);
+
+  if (whepsrc->use_link_headers) {
+    SoupMessage *msg;
+
+    GST_DEBUG_OBJECT (whepsrc, " Using link headers to get ice-servers");
+    GST_WHEP_SRC_LOCK (whepsrc);
+    msg = soup_message_new ("OPTIONS", whepsrc->whep_endpoint);
+    GST_WHEP_SRC_UNLOCK (whepsrc);
+    if (msg) {
+      gst_whip_soup_send_async (whepsrc->soup_session, msg,
+          _http_options_response_callback, gst_object_ref (whepsrc));
+      return;
+    }
+  }
+
+  _create_offer (whepsrc);
+}
+
+static void
+_on_pad_added (GstElement * webrtcbin, GstPad * pad, gpointer user_data)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (user_data);
+  GstPadTemplate *templ;
+  GstPad *srcpad;
+
+  if (GST_PAD_DIRECTION (pad) != GST_PAD_SRC)
+    return;
+
+  GST_DEBUG_OBJECT (whepsrc, "new webrtcbin pad %s:%s",
+      GST_DEBUG_PAD_NAME (pad));
+  templ = gst_static_pad_template_get (&gst_whep_src_src_template);
+  srcpad = gst_ghost_pad_new_from_template (GST_PAD_NAME (pad), pad, templ);
+  gst_object_unref (templ);
+  gst_element_add_pad (GST_ELEMENT_CAST (whepsrc), srcpad);
+}
+
+static void
+_on_pad_removed (GstElement * webrtcbin, GstPad * pad, gpointer user_data)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (user_data);
+  GstPad *srcpad;
+
+  if (GST_PAD_DIRECTION (pad) != GST_PAD_SRC)
+    return;
+
+  srcpad = gst_element_get_static_pad (GST_ELEMENT_CAST (whepsrc),
+      GST_PAD_NAME (pad));
+  if (srcpad) {
+    gst_element_remove_pad (GST_ELEMENT_CAST (whepsrc), srcpad);
+    gst_object_unref (srcpad);
+  }
+}
+
+static void
+_add_transceiver (GstWhepSrc * whepsrc, GstCaps * caps)
+{
+  GstWebRTCRTPTransceiver *trans = NULL;
+
+  GST_DEBUG_OBJECT (whepsrc, "adding recvonly transceiver for %"
+      GST_PTR_FORMAT, caps);
+  g_signal_emit_by_name (whepsrc->webrtcbin, "add-transceiver",
+      GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_RECVONLY, caps, &trans);
+  if (trans == NULL) {
+    GST_ERROR_OBJECT (whepsrc, "failed to add transceiver");
+    return;
+  }
+  g_object_set (trans, "do-nack", whepsrc->do_nack, NULL);
+  gst_object_unref (trans);
+}
+
+/* class initialization */
+
+G_DEFINE_TYPE_WITH_CODE (GstWhepSrc, gst_whep_src, GST_TYPE_BIN,
+    GST_DEBUG_CATEGORY_INIT (gst_whep_src_debug_category, "whepsrc", 0,
+        "debug category for whepsrc element"));
+
+
+static void
+gst_whep_src_class_init (GstWhepSrcClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+  GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
+  GstBinClass *gstbin_class = GST_BIN_CLASS (klass);
+
+  gobject_class->set_property = gst_whep_src_set_property;
+  gobject_class->get_property = gst_whep_src_get_property;
+  gobject_class->dispose = gst_whep_src_dispose;
+  gobject_class->finalize = gst_whep_src_finalize;
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_whep_src_change_state);
+  gstbin_class->deep_element_added =
+      GST_DEBUG_FUNCPTR (gst_whep_src_deep_element_added);
+
+  gst_element_class_add_static_pad_template (gstelement_class,
+      &gst_whep_src_src_template);
+
+  gst_element_class_set_static_metadata (gstelement_class,
+      "WHEP Bin", "Source/Network/WebRTC",
+      "A bin for WebRTC HTTP egress protocol (WHEP)",
+      "Taruntej Kanakamalla <taruntej@asymptotic.io>");
+
+  g_object_class_install_property (gobject_class,
+      PROP_WHEP_ENDPOINT,
+      g_param_spec_string ("whep-endpoint", "WHEP Endpoint",
+          "The WHEP server endpoint to POST SDP offer. "
+          "e.g.: https://example.com/whep/endpoint/room1234",
+          NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_STUN_SERVER,
+      g_param_spec_string ("stun-server", "STUN Server",
+          "The STUN server of the form stun://hostname:port",
+          NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_TURN_SERVER,
+      g_param_spec_string ("turn-server", "TURN Server",
+          "The TURN server of the form turn(s)://username:password@host:port",
+          NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_BUNDLE_POLICY,
+      g_param_spec_enum ("bundle-policy", "Bundle Policy",
+          "The policy to apply for bundling",
+          GST_TYPE_WEBRTC_BUNDLE_POLICY,
+          GST_WEBRTC_BUNDLE_POLICY_NONE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_USE_LINK_HEADERS,
+      g_param_spec_boolean ("use-link-headers", "Use Link Headers",
+          "Use Link Headers to configure ice-servers in the response from WHEP server. "
+          "If set to TRUE and the WHEP server returns valid ice-servers, "
+          "this property overrides the ice-servers values set using the stun-server and turn-server properties.",
+          TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_LATENCY,
+      g_param_spec_uint ("latency", "Latency",
+          "Size of the jitter buffers in milliseconds. Should stay above the "
+          "round trip time to the server for retransmissions to arrive",
+          0, G_MAXUINT, DEFAULT_LATENCY, G_PARAM_READWRITE |
+          G_PARAM_STATIC_STRINGS | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_DROP_ON_LATENCY,
+      g_param_spec_boolean ("drop-on-latency", "Drop on Latency",
+          "Drop packets arriving too late for the jitter buffers instead of "
+          "adding latency", DEFAULT_DROP_ON_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_DO_NACK,
+      g_param_spec_boolean ("do-nack", "Do NACK",
+          "Request retransmission of lost packets with RTCP NACK",
+          DEFAULT_DO_NACK, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_AUDIO_CAPS,
+      g_param_spec_boxed ("audio-caps", "Audio Caps",
+          "The RTP caps of the audio to receive, NULL to receive no audio",
+          GST_TYPE_CAPS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_VIDEO_CAPS,
+      g_param_spec_boxed ("video-caps", "Video Caps",
+          "The RTP caps of the video to receive, most preferred first, NULL "
+          "to receive no video",
+          GST_TYPE_CAPS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+}
+
+static void
+gst_whep_src_init (GstWhepSrc * whepsrc)
+{
+  whepsrc->webrtcbin =
+      gst_element_factory_make ("webrtcbin", "whep-webrtcbin");
+  g_object_set (whepsrc->webrtcbin, "latency", DEFAULT_LATENCY, NULL);
+  gst_bin_add (GST_BIN (whepsrc), whepsrc->webrtcbin);
+  g_signal_connect (whepsrc->webrtcbin, "on-negotiation-needed",
+      G_CALLBACK (_on_negotiation_needed), (gpointer) whepsrc);
+  g_signal_connect (whepsrc->webrtcbin, "pad-added",
+      G_CALLBACK (_on_pad_added), (gpointer) whepsrc);
+  g_signal_connect (whepsrc->webrtcbin, "pad-removed",
+      G_CALLBACK (_on_pad_removed), (gpointer) whepsrc);
+
+  whepsrc->resource_url = NULL;
+  whepsrc->have_transceivers = FALSE;
+  whepsrc->use_link_headers = TRUE;
+  whepsrc->drop_on_latency = DEFAULT_DROP_ON_LATENCY;
+  whepsrc->do_nack = DEFAULT_DO_NACK;
+  whepsrc->audio_caps = gst_caps_from_string (DEFAULT_AUDIO_CAPS);
+  whepsrc->video_caps = gst_caps_from_string (DEFAULT_VIDEO_CAPS);
+  whepsrc->soup_session = gst_whip_soup_session_get ();
+}
+
+void
+gst_whep_src_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (object);
+  GST_DEBUG_OBJECT (whepsrc, "property_id %d", property_id);
+  switch (property_id) {
+    case PROP_WHEP_ENDPOINT:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      g_free (whepsrc->whep_endpoint);
+      whepsrc->whep_endpoint = g_value_dup_string (value);
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    case PROP_STUN_SERVER:
+      g_object_set_property ((GObject *) whepsrc->webrtcbin, "stun-server",
+          value);
+      break;
+    case PROP_TURN_SERVER:
+      g_object_set_property ((GObject *) whepsrc->webrtcbin, "turn-server",
+          value);
+      break;
+    case PROP_BUNDLE_POLICY:
+      g_object_set_property ((GObject *) whepsrc->webrtcbin, "bundle-policy",
+          value);
+      break;
+    case PROP_LATENCY:
+      g_object_set_property ((GObject *) whepsrc->webrtcbin, "latency", value);
+      break;
+    case PROP_USE_LINK_HEADERS:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      whepsrc->use_link_headers = g_value_get_boolean (value);
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    case PROP_DROP_ON_LATENCY:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      whepsrc->drop_on_latency = g_value_get_boolean (value);
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    case PROP_DO_NACK:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      whepsrc->do_nack = g_value_get_boolean (value);
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    case PROP_AUDIO_CAPS:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      gst_caps_replace (&whepsrc->audio_caps,
+          (GstCaps *) gst_value_get_caps (value));
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    case PROP_VIDEO_CAPS:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      gst_caps_replace (&whepsrc->video_caps,
+          (GstCaps *) gst_value_get_caps (value));
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+void
+gst_whep_src_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (object);
+
+  switch (property_id) {
+    case PROP_WHEP_ENDPOINT:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      g_value_set_string (value, whepsrc->whep_endpoint);
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    case PROP_STUN_SERVER:
+      g_object_get_property ((GObject *) whepsrc->webrtcbin, "stun-server",
+          value);
+      break;
+    case PROP_TURN_SERVER:
+      g_object_get_property ((GObject *) whepsrc->webrtcbin, "turn-server",
+          value);
+      break;
+    case PROP_BUNDLE_POLICY:
+      g_object_get_property ((GObject *) whepsrc->webrtcbin, "bundle-policy",
+          value);
+      break;
+    case PROP_LATENCY:
+      g_object_get_property ((GObject *) whepsrc->webrtcbin, "latency", value);
+      break;
+    case PROP_USE_LINK_HEADERS:
+      g_value_set_boolean (value, whepsrc->use_link_headers);
+      break;
+    case PROP_DROP_ON_LATENCY:
+      g_value_set_boolean (value, whepsrc->drop_on_latency);
+      break;
+    case PROP_DO_NACK:
+      g_value_set_boolean (value, whepsrc->do_nack);
+      break;
+    case PROP_AUDIO_CAPS:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      gst_value_set_caps (value, whepsrc->audio_caps);
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    case PROP_VIDEO_CAPS:
+      GST_WHEP_SRC_LOCK (whepsrc);
+      gst_value_set_caps (value, whepsrc->video_caps);
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+void
+gst_whep_src_dispose (GObject * object)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (object);
+
+  if (whepsrc->resource_url && whepsrc->soup_session) {
+    SoupMessage *msg = soup_message_new ("DELETE", whepsrc->resource_url);
+    guint status = gst_whip_soup_send (whepsrc->soup_session, msg, NULL);
+    GST_DEBUG_OBJECT (whepsrc, "delete return %u", status);
+    g_object_unref (msg);
+  }
+  g_clear_pointer (&whepsrc->resource_url, g_free);
+  g_clear_object (&whepsrc->soup_session);
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+void
+gst_whep_src_finalize (GObject * object)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (object);
+
+  g_free (whepsrc->whep_endpoint);
+  gst_caps_replace (&whepsrc->audio_caps, NULL);
+  gst_caps_replace (&whepsrc->video_caps, NULL);
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+/* Tune the jitter buffers rtpbin creates inside webrtcbin for low latency */
+static void
+gst_whep_src_deep_element_added (GstBin * bin, GstBin * sub_bin,
+    GstElement * element)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (bin);
+  GstElementFactory *factory = gst_element_get_factory (element);
+
+  if (factory && g_strcmp0 (GST_OBJECT_NAME (factory), "rtpjitterbuffer") == 0) {
+    GST_DEBUG_OBJECT (whepsrc, "configuring %" GST_PTR_FORMAT, element);
+    g_object_set (element, "drop-on-latency", whepsrc->drop_on_latency, NULL);
+  }
+
+  GST_BIN_CLASS (parent_class)->deep_element_added (bin, sub_bin, element);
+}
+
+static GstStateChangeReturn
+gst_whep_src_change_state (GstElement * element, GstStateChange transition)
+{
+  GstWhepSrc *whepsrc = GST_WHEP_SRC (element);
+
+  switch (transition) {
+    case GST_STATE_CHANGE_NULL_TO_READY:
+      if (whepsrc->whep_endpoint == NULL) {
+        GST_ELEMENT_ERROR (whepsrc, RESOURCE, NOT_FOUND, (NULL),
+            ("whep-endpoint is not set"));
+        return GST_STATE_CHANGE_FAILURE;
+      }
+      //adding the transceivers triggers the negotiation
+      GST_WHEP_SRC_LOCK (whepsrc);
+      if (!whepsrc->have_transceivers) {
+        if (whepsrc->audio_caps)
+          _add_transceiver (whepsrc, whepsrc->audio_caps);
+        if (whepsrc->video_caps)
+          _add_transceiver (whepsrc, whepsrc->video_caps);
+        whepsrc->have_transceivers = TRUE;
+      }
+      GST_WHEP_SRC_UNLOCK (whepsrc);
+      break;
+    default:
+      break;
+  }
+
+  return GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+}
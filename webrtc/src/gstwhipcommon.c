@@ -0,0 +1,356 @@
+/* GStreamer
+ * Copyright (C) 2022 Taruntej Kanakamalla <taruntej@asymptotic.io>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstwhipcommon.h"
+
+GST_DEBUG_CATEGORY (gst_whip_common_debug);
+#define GST_CAT_DEFAULT gst_whip_common_debug
+
+/* libsoup 2.4 and 3.x compatibility. libsoup 3 can use HTTP/2 with https
+ * servers offering it through ALPN. The SoupSession is used from several
+ * threads, which needs libsoup 3.2 or later */
+
+typedef struct
+{
+  GstWhipSoupCallback callback;
+  gpointer user_data;
+} GstWhipSoupAsyncData;
+
+#define SOUP_TIMEOUT 30
+#define SOUP_MAX_CONNS 256
+
+/* Returns a new reference to the SoupSession to signal with. With libsoup 3
+ * every whipsink and whepsrc of the process shares one, which is kept for
+ * the lifetime of the process, so that the requests to an origin, including
+ * those of the elements recreated by a reconnect, reuse its connections
+ * instead of doing their own TCP and TLS handshakes. The connection limits
+ * are raised as the connections to an HTTP/1.1 origin are now shared */
+SoupSession *
+gst_whip_soup_session_get (void)
+{
+#ifdef HAVE_LIBSOUP3
+  static SoupSession *shared_session = NULL;
+
+  if (g_once_init_enter (&shared_session)) {
+    SoupSession *soup_session = soup_session_new_with_options ("timeout",
+        SOUP_TIMEOUT, "max-conns", SOUP_MAX_CONNS, "max-conns-per-host",
+        SOUP_MAX_CONNS, NULL);
+    g_once_init_leave (&shared_session, soup_session);
+  }
+  return g_object_ref (shared_session);
+#else
+  return soup_session_new_with_options ("timeout", SOUP_TIMEOUT, NULL);
+#endif
+}
+
+#ifdef HAVE_LIBSOUP3
+/* The connection ids tell whether the requests reuse connections */
+static void
+_soup_log_connection (SoupMessage * msg)
+{
+  GST_DEBUG ("%s: status %u, HTTP version %d, connection %" G_GUINT64_FORMAT,
+      soup_message_get_method (msg), soup_message_get_status (msg),
+      soup_message_get_http_version (msg),
+      soup_message_get_connection_id (msg));
+}
+#endif
+
+void
+gst_whip_soup_set_request_body (SoupMessage * msg, const gchar * content_type,
+    gchar * body)
+{
+#ifdef HAVE_LIBSOUP3
+  GBytes *bytes = g_bytes_new_take (body, strlen (body));
+  soup_message_set_request_body_from_bytes (msg, content_type, bytes);
+  g_bytes_unref (bytes);
+#else
+  soup_message_set_request (msg, content_type, SOUP_MEMORY_TAKE, body,
+      strlen (body));
+#endif
+}
+
+/* Sends msg synchronously and returns the status code, the response body is
+ * returned NUL terminated in body if not NULL */
+guint
+gst_whip_soup_send (SoupSession * soup_session, SoupMessage * msg,
+    gchar ** body)
+{
+#ifdef HAVE_LIBSOUP3
+  GError *error = NULL;
+  GBytes *bytes = soup_session_send_and_read (soup_session, msg, NULL, &error);
+
+  if (bytes == NULL) {
+    GST_DEBUG ("failed to send %s: %s", soup_message_get_method (msg),
+        error->message);
+    g_clear_error (&error);
+    if (body)
+      *body = NULL;
+    return soup_message_get_status (msg);
+  }
+  _soup_log_connection (msg);
+  if (body) {
+    gsize size;
+    const gchar *data = g_bytes_get_data (bytes, &size);
+    *body = g_strndup (data, size);
+  }
+  g_bytes_unref (bytes);
+  return soup_message_get_status (msg);
+#else
+  guint status = soup_session_send_message (soup_session, msg);
+  if (body)
+    *body = g_strndup (msg->response_body->data, msg->response_body->length);
+  return status;
+#endif
+}
+
+#ifdef HAVE_LIBSOUP3
+static void
+_soup_send_async_done (GObject * source, GAsyncResult * res, gpointer data)
+{
+  GstWhipSoupAsyncData *async_data = data;
+  SoupMessage *msg = soup_session_get_async_result_message (SOUP_SESSION
+      (source), res);
+  GBytes *bytes;
+  gchar *body = NULL;
+
+  bytes = soup_session_send_and_read_finish (SOUP_SESSION (source), res, NULL);
+  if (bytes) {
+    gsize size;
+    const gchar *data = g_bytes_get_data (bytes, &size);
+    body = g_strndup (data, size);
+    g_bytes_unref (bytes);
+    _soup_log_connection (msg);
+  }
+  async_data->callback (msg, body, async_data->user_data);
+  g_free (body);
+  g_object_unref (msg);
+  g_free (async_data);
+}
+#else
+static void
+_soup_send_async_done (SoupSession * soup_session, SoupMessage * msg,
+    gpointer data)
+{
+  GstWhipSoupAsyncData *async_data = data;
+  gchar *body;
+
+  body = g_strndup (msg->response_body->data, msg->response_body->length);
+  async_data->callback (msg, body, async_data->user_data);
+  g_free (body);
+  g_free (async_data);
+}
+#endif
+
+/* Sends msg asynchronously, taking ownership of it. The callback is called
+ * from the main context with the response body */
+void
+gst_whip_soup_send_async (SoupSession * soup_session, SoupMessage * msg,
+    GstWhipSoupCallback callback, gpointer user_data)
+{
+  GstWhipSoupAsyncData *async_data = g_new0 (GstWhipSoupAsyncData, 1);
+
+  async_data->callback = callback;
+  async_data->user_data = user_data;
+#ifdef HAVE_LIBSOUP3
+  soup_session_send_and_read_async (soup_session, msg, G_PRIORITY_DEFAULT,
+      NULL, _soup_send_async_done, async_data);
+#else
+  soup_session_queue_message (soup_session, msg, _soup_send_async_done,
+      async_data);
+#endif
+}
+
+guint
+gst_whip_soup_get_status (SoupMessage * msg)
+{
+#ifdef HAVE_LIBSOUP3
+  return soup_message_get_status (msg);
+#else
+  return msg->status_code;
+#endif
+}
+
+const gchar *
+gst_whip_soup_get_reason_phrase (SoupMessage * msg)
+{
+#ifdef HAVE_LIBSOUP3
+  return soup_message_get_reason_phrase (msg);
+#else
+  return msg->reason_phrase;
+#endif
+}
+
+SoupMessageHeaders *
+gst_whip_soup_get_response_headers (SoupMessage * msg)
+{
+#ifdef HAVE_LIBSOUP3
+  return soup_message_get_response_headers (msg);
+#else
+  return msg->response_headers;
+#endif
+}
+
+/* Configure the ICE servers advertised in a Link header on webrtcbin */
+void
+gst_whip_update_ice_servers (GstElement * webrtcbin, const gchar * link_header)
+{
+  GPtrArray *servers = gst_whip_parse_link_header (link_header);
+  guint i;
+
+  GST_DEBUG_OBJECT (webrtcbin, "%s", link_header);
+
+  for (i = 0; i < servers->len; i++) {
+    GstWhipIceServer *server = g_ptr_array_index (servers, i);
+
+    if (server->type == GST_WHIP_ICE_SERVER_STUN) {
+      GST_DEBUG_OBJECT (webrtcbin, "stun url %s", server->url);
+      //this overwrites the stun-server value set by set_property
+      g_object_set (webrtcbin, "stun-server", server->url, NULL);
+    } else {
+      gboolean retval;
+
+      GST_DEBUG_OBJECT (webrtcbin, "turn url %s", server->url);
+      g_signal_emit_by_name (webrtcbin, "add-turn-server", server->url,
+          &retval);
+      if (!retval)
+        GST_ERROR_OBJECT (webrtcbin, "failed to add-turn-server %s",
+            server->url);
+    }
+  }
+  g_ptr_array_unref (servers);
+}
+
+/* Socket layer statistics, only available on Linux */
+
+static gchar **
+_split_fields (const gchar * line)
+{
+  gchar **fields = g_strsplit_set (line, " \t", -1);
+  guint i, n = 0;
+
+  //drop the empty fields left by repeated spaces
+  for (i = 0; fields[i]; i++) {
+    if (fields[i][0] == '\0')
+      g_free (fields[i]);
+    else
+      fields[n++] = fields[i];
+  }
+  fields[n] = NULL;
+
+  return fields;
+}
+
+/* Reads the receive drops of all the UDP sockets of the host at once,
+ * returns a table from local port to the sum of the drops of the sockets
+ * bound to it, or NULL if unavailable */
+GHashTable *
+gst_whip_read_udp_socket_drops (void)
+{
+  GHashTable *drops = NULL;
+#ifdef __linux__
+  const gchar *files[] = { "/proc/net/udp", "/proc/net/udp6" };
+  guint f;
+
+  for (f = 0; f < G_N_ELEMENTS (files); f++) {
+    gchar *contents = NULL;
+    gchar **lines;
+    guint i;
+
+    if (!g_file_get_contents (files[f], &contents, NULL, NULL))
+      continue;
+    if (drops == NULL)
+      drops = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+          g_free);
+
+    //sl local_address rem_address st ... inode ref pointer drops
+    lines = g_strsplit (contents, "\n", -1);
+    for (i = 1; lines[i]; i++) {
+      gchar **fields = _split_fields (lines[i]);
+      guint n_fields = g_strv_length (fields);
+      const gchar *port_str;
+      gpointer port;
+      guint64 *port_drops;
+
+      if (n_fields < 13 || (port_str = strrchr (fields[1], ':')) == NULL) {
+        g_strfreev (fields);
+        continue;
+      }
+      port = GUINT_TO_POINTER (g_ascii_strtoull (port_str + 1, NULL, 16));
+      port_drops = g_hash_table_lookup (drops, port);
+      if (port_drops == NULL) {
+        port_drops = g_new0 (guint64, 1);
+        g_hash_table_insert (drops, port, port_drops);
+      }
+      *port_drops += g_ascii_strtoull (fields[n_fields - 1], NULL, 10);
+      g_strfreev (fields);
+    }
+    g_strfreev (lines);
+    g_free (contents);
+  }
+#endif
+  return drops;
+}
+
+/* The system wide count of UDP datagrams dropped for lack of socket buffer
+ * space */
+gboolean
+gst_whip_get_udp_buffer_errors (guint64 * sndbuf_errors,
+    guint64 * rcvbuf_errors)
+{
+  gboolean ret = FALSE;
+#ifdef __linux__
+  gchar *contents = NULL;
+  gchar **lines;
+  guint i, j;
+
+  if (!g_file_get_contents ("/proc/net/snmp", &contents, NULL, NULL))
+    return FALSE;
+
+  //a "Udp:" line with the names followed by one with the values
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i] && lines[i + 1]; i++) {
+    gchar **names, **values;
+
+    if (!g_str_has_prefix (lines[i], "Udp: ") ||
+        !g_str_has_prefix (lines[i + 1], "Udp: "))
+      continue;
+
+    names = _split_fields (lines[i]);
+    values = _split_fields (lines[i + 1]);
+    *sndbuf_errors = *rcvbuf_errors = 0;
+    for (j = 0; names[j] && values[j]; j++) {
+      if (g_strcmp0 (names[j], "SndbufErrors") == 0)
+        *sndbuf_errors = g_ascii_strtoull (values[j], NULL, 10);
+      else if (g_strcmp0 (names[j], "RcvbufErrors") == 0)
+        *rcvbuf_errors = g_ascii_strtoull (values[j], NULL, 10);
+    }
+    g_strfreev (names);
+    g_strfreev (values);
+    ret = TRUE;
+    break;
+  }
+  g_strfreev (lines);
+  g_free (contents);
+#endif
+  return ret;
+}
@@ -0,0 +1,58 @@
+/* GStreamer
+ * Copyright (C) 2022 Taruntej Kanakamalla <taruntej@asymptotic.io>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_WHIP_COMMON_H__
+#define __GST_WHIP_COMMON_H__
+#include <gst/gst.h>
+
+/* For signalling */
+#include <libsoup/soup.h>
+#include <string.h>
+
+#include "gstwhipsignalling.h"
+
+G_BEGIN_DECLS
+
+/* Signalling helpers shared by whipsink and whepsrc */
+
+GST_DEBUG_CATEGORY_EXTERN (gst_whip_common_debug);
+
+typedef void (*GstWhipSoupCallback) (SoupMessage * msg, const gchar * body,
+    gpointer user_data);
+
+SoupSession *gst_whip_soup_session_get (void);
+void gst_whip_soup_set_request_body (SoupMessage * msg,
+    const gchar * content_type, gchar * body);
+guint gst_whip_soup_send (SoupSession * soup_session, SoupMessage * msg,
+    gchar ** body);
+void gst_whip_soup_send_async (SoupSession * soup_session, SoupMessage * msg,
+    GstWhipSoupCallback callback, gpointer user_data);
+guint gst_whip_soup_get_status (SoupMessage * msg);
+const gchar *gst_whip_soup_get_reason_phrase (SoupMessage * msg);
+SoupMessageHeaders *gst_whip_soup_get_response_headers (SoupMessage * msg);
+
+void gst_whip_update_ice_servers (GstElement * webrtcbin,
+    const gchar * link_header);
+
+GHashTable *gst_whip_read_udp_socket_drops (void);
+gboolean gst_whip_get_udp_buffer_errors (guint64 * sndbuf_errors,
+    guint64 * rcvbuf_errors);
+
+G_END_DECLS
+#endif /*  __GST_WHIP_COMMON_H__  */
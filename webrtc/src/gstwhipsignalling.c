@@ -0,0 +1,391 @@
+/* GStreamer
+ * Copyright (C) 2022 Taruntej Kanakamalla <taruntej@asymptotic.io>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "gstwhipsignalling.h"
+
+void
+gst_whip_ice_server_free (GstWhipIceServer * server)
+{
+  g_free (server->url);
+  g_free (server);
+}
+
+static const gchar *
+_skip_spaces (const gchar * p)
+{
+  while (*p == ' ' || *p == '\t')
+    p++;
+  return p;
+}
+
+/* Skip to the next link-value, commas inside quoted strings do not count */
+static const gchar *
+_skip_link_value (const gchar * p)
+{
+  gboolean quoted = FALSE;
+
+  while (*p && (quoted || *p != ',')) {
+    if (*p == '"')
+      quoted = !quoted;
+    else if (*p == '\\' && quoted && p[1])
+      p++;
+    p++;
+  }
+  return p;
+}
+
+/* Parses a token or a quoted-string, returns the position after it. An
+ * unterminated quoted-string gives no value */
+static const gchar *
+_parse_param_value (const gchar * p, gchar ** value)
+{
+  GString *str = g_string_new (NULL);
+
+  if (*p == '"') {
+    p++;
+    while (*p && *p != '"') {
+      if (*p == '\\' && p[1])
+        p++;
+      g_string_append_c (str, *p);
+      p++;
+    }
+    if (*p != '"') {
+      g_string_free (str, TRUE);
+      *value = NULL;
+      return p;
+    }
+    p++;
+  } else {
+    while (*p && *p != ';' && *p != ',' && *p != ' ' && *p != '\t') {
+      g_string_append_c (str, *p);
+      p++;
+    }
+  }
+
+  *value = g_string_free (str, FALSE);
+  return p;
+}
+
+static gboolean
+_rel_is_ice_server (const gchar * rel)
+{
+  gchar **rels;
+  gboolean ret = FALSE;
+  guint i;
+
+  if (rel == NULL)
+    return FALSE;
+
+  rels = g_strsplit (rel, " ", -1);
+  for (i = 0; rels[i]; i++) {
+    if (g_ascii_strcasecmp (rels[i], "ice-server") == 0)
+      ret = TRUE;
+  }
+  g_strfreev (rels);
+
+  return ret;
+}
+
+static GstWhipIceServer *
+_ice_server_new (const gchar * uri, const gchar * username,
+    const gchar * credential, const gchar * credential_type)
+{
+  GstWhipIceServer *server;
+
+  if (g_ascii_strncasecmp (uri, "stun:", strlen ("stun:")) == 0) {
+    if (uri[strlen ("stun:")] == '\0')
+      return NULL;
+    server = g_new0 (GstWhipIceServer, 1);
+    server->type = GST_WHIP_ICE_SERVER_STUN;
+    server->url = g_strdup_printf ("stun://%s", uri + strlen ("stun:"));
+    return server;
+  }
+
+  if (g_ascii_strncasecmp (uri, "turn:", strlen ("turn:")) == 0 ||
+      g_ascii_strncasecmp (uri, "turns:", strlen ("turns:")) == 0) {
+    gboolean secure = g_ascii_tolower (uri[4]) == 's';
+    const gchar *host = uri + (secure ? strlen ("turns:") : strlen ("turn:"));
+    gchar *user, *pass;
+
+    //only password credentials can be passed on to webrtcbin
+    if (*host == '\0' || username == NULL || *username == '\0' ||
+        credential == NULL || *credential == '\0' ||
+        (credential_type && g_ascii_strcasecmp (credential_type,
+                "password") != 0))
+      return NULL;
+
+    //the credentials are free-form, keep them from breaking the userinfo
+    user = g_uri_escape_string (username, NULL, FALSE);
+    pass = g_uri_escape_string (credential, NULL, FALSE);
+    server = g_new0 (GstWhipIceServer, 1);
+    server->type = GST_WHIP_ICE_SERVER_TURN;
+    server->url = g_strdup_printf ("%s://%s:%s@%s", secure ? "turns" : "turn",
+        user, pass, host);
+    g_free (user);
+    g_free (pass);
+    return server;
+  }
+
+  return NULL;
+}
+
+/**
+ * gst_whip_parse_link_header:
+ * @link_header: the value of the Link header(s) of a WHIP/WHEP response
+ *
+ * Parses the link-values with rel="ice-server" as defined by the WHIP draft,
+ * e.g. <turn:turn.example.net?transport=udp>; rel="ice-server";
+ * username="user"; credential="pass"; credential-type="password"
+ *
+ * Returns: (transfer full): a #GPtrArray of #GstWhipIceServer
+ */
+GPtrArray *
+gst_whip_parse_link_header (const gchar * link_header)
+{
+  GPtrArray *servers = g_ptr_array_new_with_free_func ((GDestroyNotify)
+      gst_whip_ice_server_free);
+  const gchar *p = link_header;
+
+  while (p && *p) {
+    gchar *uri, *rel = NULL, *username = NULL, *credential = NULL;
+    gchar *credential_type = NULL;
+    const gchar *uri_end;
+    GstWhipIceServer *server;
+
+    while (*p == ',' || g_ascii_isspace (*p))
+      p++;
+    if (*p == '\0')
+      break;
+    if (*p != '<') {
+      p = _skip_link_value (p);
+      continue;
+    }
+
+    uri_end = strchr (p, '>');
+    if (uri_end == NULL)
+      break;
+    uri = g_strndup (p + 1, uri_end - p - 1);
+    p = uri_end + 1;
+
+    //link-params
+    for (;;) {
+      const gchar *name_start;
+      gchar *name, *value = NULL;
+
+      p = _skip_spaces (p);
+      if (*p != ';')
+        break;
+      p = _skip_spaces (p + 1);
+
+      name_start = p;
+      while (*p && *p != '=' && *p != ':' && *p != ';' && *p != ',' &&
+          *p != ' ' && *p != '\t')
+        p++;
+      name = g_strndup (name_start, p - name_start);
+
+      p = _skip_spaces (p);
+      //some servers send credential-type: "password"
+      if (*p == '=' || *p == ':')
+        p = _parse_param_value (_skip_spaces (p + 1), &value);
+
+      if (value == NULL) {
+        g_free (name);
+        continue;
+      }
+      if (g_ascii_strcasecmp (name, "rel") == 0 && rel == NULL)
+        rel = value;
+      else if (g_ascii_strcasecmp (name, "username") == 0 && username == NULL)
+        username = value;
+      else if (g_ascii_strcasecmp (name, "credential") == 0
+          && credential == NULL)
+        credential = value;
+      else if (g_ascii_strcasecmp (name, "credential-type") == 0
+          && credential_type == NULL)
+        credential_type = value;
+      else
+        g_free (value);
+      g_free (name);
+    }
+    p = _skip_link_value (p);
+
+    if (_rel_is_ice_server (rel)) {
+      server = _ice_server_new (uri, username, credential, credential_type);
+      if (server)
+        g_ptr_array_add (servers, server);
+    }
+
+    g_free (uri);
+    g_free (rel);
+    g_free (username);
+    g_free (credential);
+    g_free (credential_type);
+  }
+
+  return servers;
+}
+
+/**
+ * gst_whip_resolve_url:
+ * @base: the URL the request was sent to
+ * @location: the value of a Location header
+ *
+ * Returns: (transfer full) (nullable): @location resolved against @base
+ */
+gchar *
+gst_whip_resolve_url (const gchar * base, const gchar * location)
+{
+  if (base == NULL || location == NULL)
+    return NULL;
+
+  return g_uri_resolve_relative (base, location, G_URI_FLAGS_NONE, NULL);
+}
+
+/**
+ * gst_whip_build_trickle_sdpfrag:
+ * @ice_ufrag: the ICE username fragment of the session
+ * @ice_pwd: the ICE password of the session
+ * @mid: (nullable): the media stream identification of the m-line
+ * @mline_index: the index of the m-line the candidates belong to
+ * @candidates: (nullable): NULL terminated array of candidates, with or
+ *   without the leading "a="
+ * @end_of_candidates: whether to signal the end of the candidates
+ *
+ * Builds the application/trickle-ice-sdpfrag body of a PATCH request
+ * as defined in RFC 8840
+ *
+ * Returns: (transfer full): the SDP fragment
+ */
+gchar *
+gst_whip_build_trickle_sdpfrag (const gchar * ice_ufrag,
+    const gchar * ice_pwd, const gchar * mid, guint mline_index,
+    const gchar * const *candidates, gboolean end_of_candidates)
+{
+  GString *frag = g_string_sized_new (256);
+  guint i;
+
+  g_string_append_printf (frag, "a=ice-ufrag:%s\r\n", ice_ufrag);
+  g_string_append_printf (frag, "a=ice-pwd:%s\r\n", ice_pwd);
+  //the media line is a placeholder, only the mid identifies the m-line
+  g_string_append (frag, "m=audio 9 RTP/AVP 0\r\n");
+  if (mid)
+    g_string_append_printf (frag, "a=mid:%s\r\n", mid);
+  else
+    g_string_append_printf (frag, "a=mid:%u\r\n", mline_index);
+
+  for (i = 0; candidates && candidates[i]; i++) {
+    const gchar *candidate = candidates[i];
+
+    if (g_str_has_prefix (candidate, "a="))
+      candidate += strlen ("a=");
+    if (*candidate == '\0')
+      continue;
+    g_string_append_printf (frag, "a=%s\r\n", candidate);
+  }
+
+  if (end_of_candidates)
+    g_string_append (frag, "a=end-of-candidates\r\n");
+
+  return g_string_free (frag, FALSE);
+}
+
+/**
+ * gst_whip_signalling_state_transition:
+ * @state: (inout): the current state of the session
+ * @event: what happened
+ *
+ * Returns: %TRUE and updates @state if @event is valid in @state
+ */
+gboolean
+gst_whip_signalling_state_transition (GstWhipSignallingState * state,
+    GstWhipSignallingEvent event)
+{
+  GstWhipSignallingState new_state = *state;
+
+  switch (event) {
+    case GST_WHIP_SIGNALLING_EVENT_OPTIONS_SENT:
+      if (*state == GST_WHIP_SIGNALLING_STATE_NEW)
+        new_state = GST_WHIP_SIGNALLING_STATE_FETCHING_ICE_SERVERS;
+      break;
+    case GST_WHIP_SIGNALLING_EVENT_OFFER_SENT:
+      if (*state == GST_WHIP_SIGNALLING_STATE_NEW ||
+          *state == GST_WHIP_SIGNALLING_STATE_FETCHING_ICE_SERVERS)
+        new_state = GST_WHIP_SIGNALLING_STATE_OFFERING;
+      break;
+    case GST_WHIP_SIGNALLING_EVENT_ANSWER_RECEIVED:
+      if (*state == GST_WHIP_SIGNALLING_STATE_OFFERING)
+        new_state = GST_WHIP_SIGNALLING_STATE_ACTIVE;
+      break;
+    case GST_WHIP_SIGNALLING_EVENT_REQUEST_FAILED:
+      if (*state == GST_WHIP_SIGNALLING_STATE_FETCHING_ICE_SERVERS ||
+          *state == GST_WHIP_SIGNALLING_STATE_OFFERING)
+        new_state = GST_WHIP_SIGNALLING_STATE_FAILED;
+      else if (*state == GST_WHIP_SIGNALLING_STATE_TERMINATING)
+        new_state = GST_WHIP_SIGNALLING_STATE_TERMINATED;
+      break;
+    case GST_WHIP_SIGNALLING_EVENT_TERMINATE:
+      //only an active session has a resource to DELETE
+      if (*state == GST_WHIP_SIGNALLING_STATE_ACTIVE)
+        new_state = GST_WHIP_SIGNALLING_STATE_TERMINATING;
+      else if (*state != GST_WHIP_SIGNALLING_STATE_TERMINATING &&
+          *state != GST_WHIP_SIGNALLING_STATE_TERMINATED)
+        new_state = GST_WHIP_SIGNALLING_STATE_TERMINATED;
+      break;
+    case GST_WHIP_SIGNALLING_EVENT_TERMINATED:
+      if (*state == GST_WHIP_SIGNALLING_STATE_TERMINATING)
+        new_state = GST_WHIP_SIGNALLING_STATE_TERMINATED;
+      break;
+    default:
+      break;
+  }
+
+  if (new_state == *state)
+    return FALSE;
+
+  *state = new_state;
+  return TRUE;
+}
+
+const gchar *
+gst_whip_signalling_state_get_name (GstWhipSignallingState state)
+{
+  switch (state) {
+    case GST_WHIP_SIGNALLING_STATE_NEW:
+      return "new";
+    case GST_WHIP_SIGNALLING_STATE_FETCHING_ICE_SERVERS:
+      return "fetching-ice-servers";
+    case GST_WHIP_SIGNALLING_STATE_OFFERING:
+      return "offering";
+    case GST_WHIP_SIGNALLING_STATE_ACTIVE:
+      return "active";
+    case GST_WHIP_SIGNALLING_STATE_TERMINATING:
+      return "terminating";
+    case GST_WHIP_SIGNALLING_STATE_TERMINATED:
+      return "terminated";
+    case GST_WHIP_SIGNALLING_STATE_FAILED:
+      return "failed";
+    default:
+      return "unknown";
+  }
+}
@@ -0,0 +1,77 @@
+/* GStreamer
+ * Copyright (C) 2022 Taruntej Kanakamalla <taruntej@asymptotic.io>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_WHIP_SIGNALLING_H__
+#define __GST_WHIP_SIGNALLING_H__
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+/* WHIP/WHEP protocol logic which depends neither on webrtcbin nor on the
+ * HTTP client, so that it can be benchmarked and fuzzed on its own */
+
+typedef enum
+{
+  GST_WHIP_ICE_SERVER_STUN,
+  GST_WHIP_ICE_SERVER_TURN,
+} GstWhipIceServerType;
+
+typedef struct
+{
+  GstWhipIceServerType type;
+  /* stun://host:port or turn(s)://username:credential@host:port */
+  gchar *url;
+} GstWhipIceServer;
+
+void gst_whip_ice_server_free (GstWhipIceServer * server);
+GPtrArray *gst_whip_parse_link_header (const gchar * link_header);
+
+gchar *gst_whip_resolve_url (const gchar * base, const gchar * location);
+
+gchar *gst_whip_build_trickle_sdpfrag (const gchar * ice_ufrag,
+    const gchar * ice_pwd, const gchar * mid, guint mline_index,
+    const gchar * const *candidates, gboolean end_of_candidates);
+
+typedef enum
+{
+  GST_WHIP_SIGNALLING_STATE_NEW,
+  GST_WHIP_SIGNALLING_STATE_FETCHING_ICE_SERVERS,
+  GST_WHIP_SIGNALLING_STATE_OFFERING,
+  GST_WHIP_SIGNALLING_STATE_ACTIVE,
+  GST_WHIP_SIGNALLING_STATE_TERMINATING,
+  GST_WHIP_SIGNALLING_STATE_TERMINATED,
+  GST_WHIP_SIGNALLING_STATE_FAILED,
+} GstWhipSignallingState;
+
+typedef enum
+{
+  GST_WHIP_SIGNALLING_EVENT_OPTIONS_SENT,
+  GST_WHIP_SIGNALLING_EVENT_OFFER_SENT,
+  GST_WHIP_SIGNALLING_EVENT_ANSWER_RECEIVED,
+  GST_WHIP_SIGNALLING_EVENT_REQUEST_FAILED,
+  GST_WHIP_SIGNALLING_EVENT_TERMINATE,
+  GST_WHIP_SIGNALLING_EVENT_TERMINATED,
+} GstWhipSignallingEvent;
+
+gboolean gst_whip_signalling_state_transition (GstWhipSignallingState * state,
+    GstWhipSignallingEvent event);
+const gchar *gst_whip_signalling_state_get_name (GstWhipSignallingState state);
+
+G_END_DECLS
+#endif /*  __GST_WHIP_SIGNALLING_H__  */
@@ -32,10 +32,23 @@
  * ]|
  * FIXME Describe what the pipeline does.
  * </refsect2>
+ *
+ * Pads requested from the sink_%u template all belong to the default
+ * session. Pads requested as session_%u_sink_%u are grouped into further,
+ * independent WHIP sessions by the first number, each with its own
+ * webrtcbin and resource on the WHIP server, but sharing the HTTP session
+ * and ICE servers of the element. The WHIP endpoint of a session can be
+ * overridden with the whip-endpoint property of any of its pads.
+ *
+ * When max-latency is set, each pad queues the RTP packets in front of
+ * webrtcbin. Whenever more than max-latency is queued, incoming frames are
+ * dropped whole, droppable frames first and otherwise all frames up to the
+ * next keyframe, which is requested upstream.
  */
 
 #include <gst/gst.h>
 #include <gst/gst.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "gst/gstelement.h"
@@ -45,9 +58,10 @@
 #include "gst/gstparamspecs.h"
 #include "gst/gstpromise.h"
 #include "gst/webrtc/webrtc_fwd.h"
+#include <gst/video/video.h>
+#include "gstwhipcommon.h"
 #include "gstwhipsink.h"
 #include "libsoup/soup-session.h"
-#include "libsoup/soup-uri.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_whip_sink_debug_category);
 #define GST_CAT_DEFAULT gst_whip_sink_debug_category
@@ -85,6 +99,13 @@ GST_STATIC_PAD_TEMPLATE ("sink_%u",
     GST_STATIC_CAPS ("application/x-rtp")
     );
 
+static GstStaticPadTemplate gst_whip_sink_session_sink_template =
+GST_STATIC_PAD_TEMPLATE ("session_%u_sink_%u",
+    GST_PAD_SINK,
+    GST_PAD_REQUEST,
+    GST_STATIC_CAPS ("application/x-rtp")
+    );
+
 
 enum
 {
@@ -94,184 +115,548 @@ enum
   PROP_TURN_SERVER,
   PROP_BUNDLE_POLICY,
   PROP_USE_LINK_HEADERS,
+  PROP_CODEC_PREFERENCES,
+  PROP_AUDIO_PRIORITY,
+  PROP_VIDEO_PRIORITY,
+  PROP_MAX_LATENCY,
+  PROP_MIN_RTP_PORT,
+  PROP_MAX_RTP_PORT,
+  PROP_ICE_TCP,
+  PROP_SEND_BUFFER_SIZE,
+  PROP_RECEIVE_BUFFER_SIZE,
+  PROP_STATS,
 };
 
+enum
+{
+  PROP_PAD_0,
+  PROP_PAD_PRIORITY,
+  PROP_PAD_WHIP_ENDPOINT,
+  PROP_PAD_DROPPED_FRAMES,
+  PROP_PAD_DROPPED_BUFFERS,
+  PROP_PAD_KEYFRAME_REQUESTS,
+};
+
+#define DEFAULT_AUDIO_PRIORITY GST_WEBRTC_PRIORITY_TYPE_HIGH
+#define DEFAULT_VIDEO_PRIORITY GST_WEBRTC_PRIORITY_TYPE_LOW
+#define DEFAULT_MAX_LATENCY 0
+#define DEFAULT_MIN_RTP_PORT 0
+#define DEFAULT_MAX_RTP_PORT 65535
+#define DEFAULT_ICE_TCP TRUE
+#define DEFAULT_SEND_BUFFER_SIZE 0
+#define DEFAULT_RECEIVE_BUFFER_SIZE 0
+
+/* Caps coming from a pad request are only useful as codec preferences when
+ * they actually name a codec, the generic template caps do not */
+static gboolean
+_caps_have_encoding_name (const GstCaps * caps)
+{
+  guint i;
+
+  if (caps == NULL || gst_caps_is_any (caps) || gst_caps_is_empty (caps))
+    return FALSE;
+
+  for (i = 0; i < gst_caps_get_size (caps); i++) {
+    const GstStructure *s = gst_caps_get_structure (caps, i);
+    if (gst_structure_get_string (s, "encoding-name") == NULL)
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+/* Keep only the structures of the ordered codec-preferences that apply to
+ * the media kind of a transceiver, preserving their order. The kind must be
+ * known, the whole list would mix audio and video codecs on one m-line */
+static GstCaps *
+_filter_codec_preferences (const GstCaps * prefs, GstWebRTCKind kind)
+{
+  const gchar *media;
+  GstCaps *filtered;
+  guint i;
+
+  if (kind == GST_WEBRTC_KIND_AUDIO)
+    media = "audio";
+  else if (kind == GST_WEBRTC_KIND_VIDEO)
+    media = "video";
+  else
+    g_return_val_if_reached (NULL);
+
+  filtered = gst_caps_new_empty ();
+  for (i = 0; i < gst_caps_get_size (prefs); i++) {
+    const GstStructure *s = gst_caps_get_structure (prefs, i);
+    const gchar *s_media = gst_structure_get_string (s, "media");
+
+    if (s_media == NULL || g_strcmp0 (s_media, media) == 0)
+      gst_caps_append_structure (filtered, gst_structure_copy (s));
+  }
+
+  return filtered;
+}
+
+/* Apply the element-wide codec-preferences to a transceiver which has none
+ * yet, once its media kind is known */
 static void
-_update_ice_servers (GstWhipSink * whipsink, const gchar * link_header)
+_apply_codec_preferences (GstWhipSink * whipsink,
+    GstWebRTCRTPTransceiver * trans, GstWebRTCKind kind)
+{
+  GstCaps *trans_prefs = NULL;
+
+  if (kind == GST_WEBRTC_KIND_UNKNOWN)
+    return;
+
+  GST_WHIP_SINK_LOCK (whipsink);
+  if (whipsink->codec_preferences) {
+    g_object_get (trans, "codec-preferences", &trans_prefs, NULL);
+    if (trans_prefs == NULL) {
+      trans_prefs =
+          _filter_codec_preferences (whipsink->codec_preferences, kind);
+      GST_DEBUG_OBJECT (whipsink, "trans codec preferences %"
+          GST_PTR_FORMAT, trans_prefs);
+      if (!gst_caps_is_empty (trans_prefs))
+        g_object_set (trans, "codec-preferences", trans_prefs, NULL);
+    }
+    gst_caps_unref (trans_prefs);
+  }
+  GST_WHIP_SINK_UNLOCK (whipsink);
+}
+
+/* Codec preferences for a new request pad: the caps passed to the request,
+ * ordered and restricted by the element-wide codec-preferences if set */
+static GstCaps *
+_get_pad_codec_preferences (GstWhipSink * whipsink, const GstCaps * caps)
 {
-  int i = 0;
-  gchar **lists = g_strsplit (link_header, ", ", -1);
+  GstCaps *prefs = NULL;
 
-  while (lists[i] != NULL) {
+  if (!_caps_have_encoding_name (caps)) {
+    /* the element-wide preferences get applied per transceiver kind in
+     * _on_negotiation_needed */
+    return NULL;
+  }
 
-    GST_DEBUG_OBJECT (whipsink, "%s", lists[i]);
-    gchar *ice_server = g_strstr_len (lists[i], -1, "rel=\"ice-server\"");
+  if (whipsink->codec_preferences) {
+    prefs = gst_caps_intersect_full (whipsink->codec_preferences, caps,
+        GST_CAPS_INTERSECT_FIRST);
+    if (gst_caps_is_empty (prefs)) {
+      GST_WARNING_OBJECT (whipsink, "requested caps %" GST_PTR_FORMAT
+          " do not match codec-preferences %" GST_PTR_FORMAT, caps,
+          whipsink->codec_preferences);
+      gst_caps_unref (prefs);
+      prefs = NULL;
+    }
+  }
 
-    if (ice_server) {
-      int j = 0;
-      gchar **members = g_strsplit (lists[i], "; ", -1);
-      gchar *stun_svr = NULL;
-      gchar *turn_svr = NULL, *turn_s_svr = NULL, *turn_user =
-          NULL, *turn_pass = NULL;
-      gchar *turn_cred_type = NULL;
-      while (members[j] != NULL) {
-        //todo can this be done using a lookup table or a hashmap
-
-        if (0 == g_ascii_strncasecmp (members[j], "<stun:", strlen ("<stun:"))) {
-
-          //start after leading '<stun:'
-          stun_svr = g_strdup (members[j] + strlen ("<stun:"));
-          //remove trailing '>'
-          stun_svr[strlen (stun_svr) - 1] = '\0';
-
-        } else if (0 == g_ascii_strncasecmp (members[j], "<turn:",
-                strlen ("<turn:"))) {
-
-          //start after leading '<turn:'
-          turn_svr = g_strdup (members[j] + strlen ("<turn:"));
-          //remove trailing '>'
-          turn_svr[strlen (turn_svr) - 1] = '\0';
-
-        } else if (0 == g_ascii_strncasecmp (members[j], "<turns:",
-                strlen ("<turns:"))) {
-
-          //start after leading '<turn:'
-          turn_s_svr = g_strdup (members[j] + strlen ("<turns:"));
-          //remove trailing '>'
-          turn_s_svr[strlen (turn_s_svr) - 1] = '\0';
-
-        } else if (0 == g_ascii_strncasecmp (members[j], "username=\"",
-                strlen ("username=\""))) {
-
-          //start after leading '"'
-          turn_user = g_strdup (members[j] + strlen ("username=\""));
-          //remove trailing '"'
-          turn_user[strlen (turn_user) - 1] = '\0';
-
-        } else if (0 == g_ascii_strncasecmp (members[j], "credential=\"",
-                strlen ("credential=\""))) {
-
-          //start after leading '"'
-          turn_pass = g_strdup (members[j] + strlen ("credential=\""));
-          //remove trailing '"'
-          turn_pass[strlen (turn_pass) - 1] = '\0';
-
-        } else if (0 == g_ascii_strncasecmp (members[j], "credential-type: \"",
-                strlen ("credential-type: \""))) {
-
-          //start after leading '"'
-          turn_cred_type =
-              g_strdup (members[j] + strlen ("credential-type: \""));
-          //remove trailing '"'
-          turn_cred_type[strlen (turn_cred_type) - 1] = '\0';
-
-        }
-        j++;
-      }
+  if (prefs == NULL)
+    prefs = gst_caps_copy (caps);
+
+  return prefs;
+}
+
+static GstWebRTCKind
+_get_pad_kind (GstPad * pad, GstWebRTCRTPTransceiver * trans)
+{
+  GstWebRTCKind kind = GST_WEBRTC_KIND_UNKNOWN;
+  GstCaps *caps;
+
+  if (trans)
+    g_object_get (trans, "kind", &kind, NULL);
+  if (kind != GST_WEBRTC_KIND_UNKNOWN)
+    return kind;
+
+  caps = gst_pad_get_current_caps (pad);
+  if (caps) {
+    const gchar *media =
+        gst_structure_get_string (gst_caps_get_structure (caps, 0), "media");
+    if (g_strcmp0 (media, "audio") == 0)
+      kind = GST_WEBRTC_KIND_AUDIO;
+    else if (g_strcmp0 (media, "video") == 0)
+      kind = GST_WEBRTC_KIND_VIDEO;
+    gst_caps_unref (caps);
+  }
+
+  return kind;
+}
+
+/* The priority set on the pad, or else the default of its media kind */
+static GstWebRTCPriorityType
+_get_pad_priority (GstWhipSink * whipsink, GstWhipSinkPad * pad,
+    GstWebRTCRTPTransceiver * trans)
+{
+  GstWebRTCPriorityType priority;
+
+  GST_OBJECT_LOCK (pad);
+  if (pad->priority_set) {
+    priority = pad->priority;
+    GST_OBJECT_UNLOCK (pad);
+    return priority;
+  }
+  GST_OBJECT_UNLOCK (pad);
+
+  GST_WHIP_SINK_LOCK (whipsink);
+  if (_get_pad_kind (GST_PAD (pad), trans) == GST_WEBRTC_KIND_AUDIO)
+    priority = whipsink->audio_priority;
+  else
+    priority = whipsink->video_priority;
+  GST_WHIP_SINK_UNLOCK (whipsink);
+
+  return priority;
+}
+
+static GstWebRTCRTPTransceiver *
+_get_pad_transceiver (GstWhipSinkPad * pad)
+{
+  GstWebRTCRTPTransceiver *trans = NULL;
+
+  if (pad->webrtcbin_pad)
+    g_object_get (pad->webrtcbin_pad, "transceiver", &trans, NULL);
+  return trans;
+}
 
-      if (stun_svr) {
-
-        gchar *stun_url = g_strdup_printf ("stun://%s", stun_svr);
-        GST_DEBUG_OBJECT (whipsink, "stun url %s", stun_url);
-
-        //this overwrites the stun-server value set by set_property
-        g_object_set (whipsink->webrtcbin, "stun-server", stun_url, NULL);
-        g_free (stun_url);
-
-      } else if (turn_svr) {
-
-        if (!g_ascii_strncasecmp (turn_cred_type, "password",
-                strlen ("password")) && turn_user && turn_pass) {
-          gchar *turn_url =
-              g_strdup_printf ("turn://%s:%s@%s", turn_user, turn_pass,
-              turn_svr);
-
-          gboolean retval;
-          GST_DEBUG_OBJECT (whipsink, "turn url %s", turn_url);
-          g_signal_emit_by_name (whipsink->webrtcbin, "add-turn-server",
-              turn_url, &retval);
-          if (!retval)
-            GST_ERROR_OBJECT (whipsink, "failed to add-turn-server %s",
-                turn_url);
-          g_free (turn_url);
-
-        }
-      } else if (turn_s_svr) {
-
-        if (!g_ascii_strncasecmp (turn_cred_type, "password",
-                strlen ("password")) && turn_user && turn_pass) {
-          gchar *turn_s_url =
-              g_strdup_printf ("turns://%s:%s@%s", turn_user, turn_pass,
-              turn_s_svr);
-          gboolean retval;
-          GST_DEBUG_OBJECT (whipsink, "turns url %s", turn_s_url);
-          g_signal_emit_by_name (whipsink->webrtcbin, "add-turn-server",
-              turn_s_url, &retval);
-          if (!retval)
-            GST_ERROR_OBJECT (whipsink, "failed to add-turn-server %s",
-                turn_s_url);
-          g_free (turn_s_url);
-
-        }
+/* Map the priority of a sink pad onto the sender of its transceiver, which
+ * webrtcbin uses for the DSCP marking of the outgoing packets */
+static void
+_apply_pad_priority (GstWhipSink * whipsink, GstWhipSinkPad * pad)
+{
+  GstWebRTCRTPTransceiver *trans = _get_pad_transceiver (pad);
+  GstWebRTCPriorityType priority;
+
+  if (trans == NULL)
+    return;
+
+  priority = _get_pad_priority (whipsink, pad, trans);
+  if (trans->sender) {
+    GST_DEBUG_OBJECT (pad, "setting sender priority %d", priority);
+    gst_webrtc_rtp_sender_set_priority (trans->sender, priority);
+  }
+  gst_object_unref (trans);
+}
+
+static gboolean
+_apply_pad_priority_foreach (GstElement * element, GstPad * pad,
+    gpointer user_data G_GNUC_UNUSED)
+{
+  if (GST_IS_WHIP_SINK_PAD (pad))
+    _apply_pad_priority (GST_WHIP_SINK (element), GST_WHIP_SINK_PAD (pad));
+  return TRUE;
+}
+
+/* Pads requested without caps only learn their media kind from the CAPS
+ * event, which can arrive after the first negotiation-needed, so both the
+ * codec preferences and the default priority of the kind are applied then */
+static void
+_on_pad_caps_notify (GstPad * pad, GParamSpec * pspec G_GNUC_UNUSED,
+    gpointer user_data)
+{
+  GstWhipSink *whipsink = user_data;
+  GstWebRTCRTPTransceiver *trans =
+      _get_pad_transceiver (GST_WHIP_SINK_PAD (pad));
+
+  if (trans == NULL)
+    return;
+
+  _apply_codec_preferences (whipsink, trans, _get_pad_kind (pad, trans));
+  gst_object_unref (trans);
+
+  _apply_pad_priority (whipsink, GST_WHIP_SINK_PAD (pad));
+}
+
+/* Admission stage: decides per frame, i.e. per RTP timestamp, whether the
+ * packets entering the queue are admitted or dropped, so that no partial
+ * frame ever reaches webrtcbin and the queue never holds much more than
+ * max_latency */
+
+#define KEYFRAME_REQUEST_INTERVAL (G_USEC_PER_SEC)
+
+static void
+_request_keyframe (GstWhipSinkPad * pad)
+{
+  GST_DEBUG_OBJECT (pad, "requesting keyframe");
+  pad->last_keyframe_request = g_get_monotonic_time ();
+  GST_OBJECT_LOCK (pad);
+  pad->keyframe_requests++;
+  GST_OBJECT_UNLOCK (pad);
+  gst_pad_push_event (GST_PAD (pad),
+      gst_video_event_new_upstream_force_key_unit (GST_CLOCK_TIME_NONE, TRUE,
+          0));
+}
+
+static void
+_decide_frame (GstWhipSinkPad * pad, GstBuffer * buffer)
+{
+  guint64 level = 0;
+  gboolean delta = GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  if (pad->wait_keyframe) {
+    //payloaders not copying the delta flag make every frame look like a
+    //keyframe, then only the keyframe announced by the encoder is trusted
+    if (!pad->keyframe_coming && !(pad->seen_delta && !delta)) {
+      if (g_get_monotonic_time () - pad->last_keyframe_request >
+          KEYFRAME_REQUEST_INTERVAL)
+        _request_keyframe (pad);
+      pad->drop_frame = TRUE;
+      return;
+    }
+    GST_DEBUG_OBJECT (pad, "resuming at keyframe");
+    pad->wait_keyframe = FALSE;
+    pad->keyframe_coming = FALSE;
+  }
+
+  g_object_get (pad->queue, "current-level-time", &level, NULL);
+  pad->drop_frame = level > pad->max_latency;
+  if (!pad->drop_frame)
+    return;
+
+  GST_LOG_OBJECT (pad, "%" GST_TIME_FORMAT " queued, dropping frame",
+      GST_TIME_ARGS (level));
+  //non-reference frames can go without breaking the decoding
+  if (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DROPPABLE))
+    return;
+
+  //the following delta frames cannot be decoded without this one
+  if (pad->is_video) {
+    pad->wait_keyframe = TRUE;
+    pad->keyframe_coming = FALSE;
+    _request_keyframe (pad);
+  }
+}
+
+/* Returns TRUE if the packet is to be dropped. The sequence numbers of the
+ * packets sent are shifted so that the receiver does not see the dropped
+ * packets as lost */
+static gboolean
+_admit_buffer (GstWhipSinkPad * pad, GstBuffer ** buffer)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint32 rtptime;
+  guint16 seqnum;
+
+  if (!gst_rtp_buffer_map (*buffer, GST_MAP_READ, &rtp))
+    return FALSE;
+  rtptime = gst_rtp_buffer_get_timestamp (&rtp);
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  if (GST_BUFFER_FLAG_IS_SET (*buffer, GST_BUFFER_FLAG_DELTA_UNIT))
+    pad->seen_delta = TRUE;
+
+  if (!pad->have_rtptime || rtptime != pad->last_rtptime) {
+    pad->have_rtptime = TRUE;
+    pad->last_rtptime = rtptime;
+    _decide_frame (pad, *buffer);
+    if (pad->drop_frame) {
+      GST_OBJECT_LOCK (pad);
+      pad->dropped_frames++;
+      GST_OBJECT_UNLOCK (pad);
+    }
+  }
+
+  if (pad->drop_frame) {
+    GST_OBJECT_LOCK (pad);
+    pad->dropped_buffers++;
+    GST_OBJECT_UNLOCK (pad);
+    pad->seqnum_offset++;
+    return TRUE;
+  }
+
+  if (pad->seqnum_offset) {
+    *buffer = gst_buffer_make_writable (*buffer);
+    if (gst_rtp_buffer_map (*buffer, GST_MAP_WRITE, &rtp)) {
+      gst_rtp_buffer_set_seq (&rtp, seqnum - pad->seqnum_offset);
+      gst_rtp_buffer_unmap (&rtp);
+    }
+  }
+
+  return FALSE;
+}
+
+static gboolean
+_admit_list_buffer (GstBuffer ** buffer, guint idx G_GNUC_UNUSED,
+    gpointer user_data)
+{
+  GstWhipSinkPad *pad = user_data;
+
+  if (_admit_buffer (pad, buffer))
+    gst_clear_buffer (buffer);
+  return TRUE;
+}
+
+static GstPadProbeReturn
+_admission_probe (GstPad * queue_pad G_GNUC_UNUSED, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstWhipSinkPad *pad = user_data;
+
+  if (info->type & GST_PAD_PROBE_TYPE_BUFFER) {
+    GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+
+    if (_admit_buffer (pad, &buffer))
+      return GST_PAD_PROBE_DROP;
+    info->data = buffer;
+  } else if (info->type & GST_PAD_PROBE_TYPE_BUFFER_LIST) {
+    GstBufferList *list = GST_PAD_PROBE_INFO_BUFFER_LIST (info);
+
+    list = gst_buffer_list_make_writable (list);
+    gst_buffer_list_foreach (list, _admit_list_buffer, pad);
+    info->data = list;
+    if (gst_buffer_list_length (list) == 0)
+      return GST_PAD_PROBE_DROP;
+  } else if (info->type & GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM) {
+    GstEvent *event = GST_PAD_PROBE_INFO_EVENT (info);
+
+    if (GST_EVENT_TYPE (event) == GST_EVENT_CAPS) {
+      GstCaps *caps;
+      const gchar *media;
+
+      gst_event_parse_caps (event, &caps);
+      media = gst_structure_get_string (gst_caps_get_structure (caps, 0),
+          "media");
+      pad->is_video = g_strcmp0 (media, "video") == 0;
+    } else if (gst_video_event_is_force_key_unit (event)) {
+      //the encoder announces the keyframe answering the request
+      if (pad->wait_keyframe) {
+        GST_DEBUG_OBJECT (pad, "keyframe announced");
+        pad->keyframe_coming = TRUE;
       }
-      g_strfreev (members);
-      g_free (stun_svr);
-      g_free (turn_svr);
-      g_free (turn_s_svr);
-      g_free (turn_user);
-      g_free (turn_pass);
-      g_free (turn_cred_type);
+    } else if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+      pad->have_rtptime = FALSE;
+      pad->drop_frame = FALSE;
+      pad->wait_keyframe = FALSE;
+      pad->keyframe_coming = FALSE;
     }
-    i++;
   }
-  g_strfreev (lists);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Puts a queue between the ghost pad and webrtcbin which stops admitting
+ * frames once more than max_latency is queued */
+static GstPad *
+_add_admission_stage (GstWhipSink * whipsink, GstWhipSinkPad * pad,
+    GstPad * wb_sink_pad, GstClockTime max_latency)
+{
+  GstPad *queue_pad;
+
+  pad->queue = gst_element_factory_make ("queue", NULL);
+  if (pad->queue == NULL) {
+    GST_WARNING_OBJECT (whipsink, "no queue element, not limiting latency");
+    return gst_object_ref (wb_sink_pad);
+  }
+
+  pad->max_latency = max_latency;
+  //no frame is admitted above max_latency, so the queue holds at most
+  //max_latency and one frame and never blocks upstream
+  g_object_set (pad->queue, "max-size-buffers", 0, "max-size-bytes", 0,
+      "max-size-time", max_latency + GST_SECOND, "silent", TRUE, NULL);
+  gst_bin_add (GST_BIN (whipsink), pad->queue);
+
+  queue_pad = gst_element_get_static_pad (pad->queue, "src");
+  gst_pad_link (queue_pad, wb_sink_pad);
+  gst_object_unref (queue_pad);
+
+  queue_pad = gst_element_get_static_pad (pad->queue, "sink");
+  gst_pad_add_probe (queue_pad, GST_PAD_PROBE_TYPE_BUFFER |
+      GST_PAD_PROBE_TYPE_BUFFER_LIST | GST_PAD_PROBE_TYPE_EVENT_DOWNSTREAM,
+      _admission_probe, pad, NULL);
+
+  gst_element_sync_state_with_parent (pad->queue);
+
+  return queue_pad;
+}
+
+static const gchar *
+_session_get_endpoint (GstWhipSinkSession * session)
+{
+  if (session->whip_endpoint)
+    return session->whip_endpoint;
+  return session->whipsink->whip_endpoint;
+}
+
+static void _session_free (GstWhipSinkSession * session);
+
+/* Sessions are referenced by the sessions table and by the pending HTTP
+ * requests and offers, which can outlive the removal of the session */
+static GstWhipSinkSession *
+_session_ref (GstWhipSinkSession * session)
+{
+  g_atomic_int_inc (&session->ref_count);
+  return session;
+}
+
+static void
+_session_unref (GstWhipSinkSession * session)
+{
+  if (g_atomic_int_dec_and_test (&session->ref_count))
+    _session_free (session);
+}
+
+static gboolean
+_session_is_removed (GstWhipSinkSession * session)
+{
+  return g_atomic_int_get (&session->removed);
+}
+
+/* Signalling state updates come from webrtcbin's signalling thread, the HTTP
+ * callbacks and the application thread */
+static void
+_session_transition (GstWhipSinkSession * session,
+    GstWhipSignallingEvent event)
+{
+  GstWhipSink *whipsink = session->whipsink;
+  GstWhipSignallingState old_state;
+
+  GST_WHIP_SINK_LOCK (whipsink);
+  old_state = session->signalling_state;
+  if (gst_whip_signalling_state_transition (&session->signalling_state, event))
+    GST_DEBUG_OBJECT (whipsink, "session %u signalling state %s -> %s",
+        session->id, gst_whip_signalling_state_get_name (old_state),
+        gst_whip_signalling_state_get_name (session->signalling_state));
+  GST_WHIP_SINK_UNLOCK (whipsink);
 }
 
 static void
-_send_sdp (GstWhipSink * whipsink, GstWebRTCSessionDescription * desc,
+_send_sdp (GstWhipSinkSession * session, GstWebRTCSessionDescription * desc,
     gchar ** answer)
 {
+  GstWhipSink *whipsink = session->whipsink;
+  const gchar *endpoint = _session_get_endpoint (session);
   gchar *text;
 
   text = gst_sdp_message_as_text (desc->sdp);
 
-  GST_DEBUG_OBJECT (whipsink, "...\n%s", text);
+  GST_DEBUG_OBJECT (whipsink, "session %u ...\n%s", session->id, text);
   SoupMessage *msg;
 
-  msg = soup_message_new ("POST", (const char *) whipsink->whip_endpoint);
-  soup_message_set_request (msg, "application/sdp", SOUP_MEMORY_COPY,
-      (const char *) text, strlen (text));
-  guint status = soup_session_send_message (whipsink->soup_session, msg);
-  GST_DEBUG_OBJECT (whipsink, "msg status %u \n%s", status,
-      msg->response_body->data);
+  gchar *body = NULL;
+
+  msg = soup_message_new ("POST", endpoint);
+  gst_whip_soup_set_request_body (msg, "application/sdp", text);
+  _session_transition (session, GST_WHIP_SIGNALLING_EVENT_OFFER_SENT);
+  guint status = gst_whip_soup_send (whipsink->soup_session, msg, &body);
+  GST_DEBUG_OBJECT (whipsink, "msg status %u \n%s", status, body);
   if (status == 201) {
-    *answer = g_strdup (msg->response_body->data);
+    *answer = body;
+    _session_transition (session, GST_WHIP_SIGNALLING_EVENT_ANSWER_RECEIVED);
   } else {
     //todo handle else case
+    _session_transition (session, GST_WHIP_SIGNALLING_EVENT_REQUEST_FAILED);
+    g_free (body);
+    g_object_unref (msg);
     return;
   }
   const char *location =
-      soup_message_headers_get_one (msg->response_headers, "location");
-  if (location != NULL && location[0] == '/') {
-    SoupURI *uri = soup_uri_new (whipsink->whip_endpoint);
-    soup_uri_set_path (uri, location);
-    whipsink->resource_url = soup_uri_to_string (uri, FALSE);
-    GST_DEBUG_OBJECT (whipsink, "resource url is %s", whipsink->resource_url);
-    soup_uri_free (uri);
-  }
-  // if (whipsink->use_link_headers) {
-  //   //update the ice-servers if they exist
-  //   const char *link_header =
-  //       soup_message_headers_get_list (msg->response_headers, "link");
-  //   if (link_header == NULL) {
-  //     GST_WARNING_OBJECT (whipsink,
-  //         "Link headers not found in the POST response");
-  //   } else {
-  //     GST_INFO_OBJECT (whipsink, "Updating ice servers from POST response - %s",
-  //         link_header);
-  //     _update_ice_servers (whipsink, link_header);
-  //   }
-  // }
+      soup_message_headers_get_one (gst_whip_soup_get_response_headers
+      (msg), "location");
+  if (location != NULL) {
+    gchar *resource_url = gst_whip_resolve_url (endpoint, location);
+
+    GST_DEBUG_OBJECT (whipsink, "session %u resource url is %s", session->id,
+        resource_url);
+    //the stats getter reads it from the application thread
+    GST_WHIP_SINK_LOCK (whipsink);
+    g_free (session->resource_url);
+    session->resource_url = resource_url;
+    GST_WHIP_SINK_UNLOCK (whipsink);
+  }
   g_object_unref (msg);
 }
 
@@ -279,8 +664,15 @@ _send_sdp (GstWhipSink * whipsink, GstWebRTCSessionDescription * desc,
 static void
 _on_offer_created (GstPromise * promise, gpointer userdata)
 {
-  GstWhipSink *ws = GST_WHIP_SINK (userdata);
-  gpointer webrtcbin = ws->webrtcbin;
+  GstWhipSinkSession *session = userdata;
+  GstWhipSink *ws = session->whipsink;
+  gpointer webrtcbin = session->webrtcbin;
+  if (_session_is_removed (session)) {
+    GST_DEBUG_OBJECT (ws, "session %u removed, not sending the offer",
+        session->id);
+    gst_promise_unref (promise);
+    return;
+  }
   if (gst_promise_wait (promise) == GST_PROMISE_RESULT_REPLIED) {
     GstWebRTCSessionDescription *offer;
     const GstStructure *reply;
@@ -292,9 +684,20 @@ _on_offer_created (GstPromise * promise, gpointer userdata)
     //todo add ice candidates from the ice-server
     g_signal_emit_by_name (webrtcbin, "set-local-description", offer, NULL);
     gchar *answer = NULL;
-    _send_sdp (ws, offer, &answer);
-    if (answer == NULL)
+    _send_sdp (session, offer, &answer);
+    if (answer == NULL) {
+      GST_WARNING_OBJECT (ws, "session %u got no answer", session->id);
+      gst_webrtc_session_description_free (offer);
       return;
+    }
+    //the resource is deleted by _session_remove once this thread is done
+    if (_session_is_removed (session)) {
+      GST_DEBUG_OBJECT (ws, "session %u removed, ignoring the answer",
+          session->id);
+      gst_webrtc_session_description_free (offer);
+      g_free (answer);
+      return;
+    }
     GstWebRTCSessionDescription *answer_sdp;
     GstSDPMessage *sdp_msg;
     gst_sdp_message_new_from_text (answer, &sdp_msg);
@@ -310,77 +713,135 @@ _on_offer_created (GstPromise * promise, gpointer userdata)
 }
 
 static void
-_http_options_response_callback (SoupSession * session, SoupMessage * msg,
-    gpointer userdata)
+_session_create_offer (GstWhipSinkSession * session)
+{
+  GstPromise *promise = gst_promise_new_with_change_func (_on_offer_created,
+      (gpointer) _session_ref (session),
+      (GDestroyNotify) _session_unref);
+  g_signal_emit_by_name ((gpointer) session->webrtcbin, "create-offer", NULL,
+      promise);
+}
+
+/* The ICE servers advertised by the WHIP server are fetched once and shared
+ * by all the sessions of the element */
+static void
+_session_apply_link_header (GstWhipSinkSession * session,
+    const gchar * link_header)
 {
-  GstWhipSink *whipsink = GST_WHIP_SINK (userdata);
-  if (msg->status_code != 200 && msg->status_code != 204) {
-    GST_DEBUG_OBJECT (whipsink, " [%u] %s\n\n", msg->status_code,
-        msg->status_code ? msg->reason_phrase : "HTTP error");
+  GstWhipSink *whipsink = session->whipsink;
+
+  GST_WHIP_SINK_LOCK (whipsink);
+  if (link_header && whipsink->link_header == NULL)
+    whipsink->link_header = g_strdup (link_header);
+  GST_WHIP_SINK_UNLOCK (whipsink);
+
+  if (link_header) {
+    GST_DEBUG_OBJECT (whipsink, "session %u link headers :%s", session->id,
+        link_header);
+    gst_whip_update_ice_servers (session->webrtcbin, link_header);
+  }
+}
+
+static void
+_http_options_response_callback (SoupMessage * msg,
+    const gchar * body G_GNUC_UNUSED, gpointer userdata)
+{
+  GstWhipSinkSession *session = userdata;
+  GstWhipSink *whipsink = session->whipsink;
+  guint status = gst_whip_soup_get_status (msg);
+
+  //the webrtcbin of a removed session is gone
+  if (_session_is_removed (session)) {
+    GST_DEBUG_OBJECT (whipsink, "session %u removed, ignoring OPTIONS "
+        "response", session->id);
+  } else if (status != 200 && status != 204) {
+    GST_DEBUG_OBJECT (whipsink, " [%u] %s\n\n", status,
+        status ? gst_whip_soup_get_reason_phrase (msg) : "HTTP error");
+    _session_transition (session, GST_WHIP_SIGNALLING_EVENT_REQUEST_FAILED);
   } else {
     GST_INFO_OBJECT (whipsink, "Updating ice servers from OPTIONS response");
     const gchar *link_header =
-        soup_message_headers_get_list (msg->response_headers, "link");
-    if (link_header) {
-      GST_DEBUG_OBJECT (whipsink, "link headers :%s", link_header);
-      _update_ice_servers (whipsink, link_header);
-    }
-
-    GstPromise *promise = gst_promise_new_with_change_func (_on_offer_created,
-        (gpointer) whipsink,
-        NULL);
-    g_signal_emit_by_name ((gpointer) whipsink->webrtcbin, "create-offer", NULL,
-        promise);
+        soup_message_headers_get_list (gst_whip_soup_get_response_headers
+        (msg), "link");
+    _session_apply_link_header (session, link_header);
+    _session_create_offer (session);
   }
+
+  _session_unref (session);
+  gst_object_unref (whipsink);
 }
 
 static void
-_configure_ice_servers_from_link_headers (GstWhipSink * whipsink,
+_configure_ice_servers_from_link_headers (GstWhipSinkSession * session,
     gboolean async)
 {
+  GstWhipSink *whipsink = session->whipsink;
+  gchar *link_header;
+
+  GST_WHIP_SINK_LOCK (whipsink);
+  link_header = g_strdup (whipsink->link_header);
+  GST_WHIP_SINK_UNLOCK (whipsink);
+
+  if (link_header) {
+    GST_DEBUG_OBJECT (whipsink, "Reusing ice-servers from link headers");
+    _session_apply_link_header (session, link_header);
+    g_free (link_header);
+    _session_create_offer (session);
+    return;
+  }
+
   GST_DEBUG_OBJECT (whipsink, " Using link headers to get ice-servers");
   SoupMessage *msg =
-      soup_message_new ("OPTIONS", (const char *) whipsink->whip_endpoint);
+      soup_message_new ("OPTIONS", _session_get_endpoint (session));
+  _session_transition (session, GST_WHIP_SIGNALLING_EVENT_OPTIONS_SENT);
   if (async) {
-    soup_session_queue_message (whipsink->soup_session, msg,
-        _http_options_response_callback, whipsink);
+    //keep both alive until the response, the callback drops the refs
+    gst_object_ref (whipsink);
+    gst_whip_soup_send_async (whipsink->soup_session, msg,
+        _http_options_response_callback, _session_ref (session));
   } else {
-    guint status = soup_session_send_message (whipsink->soup_session, msg);
+    guint status = gst_whip_soup_send (whipsink->soup_session, msg, NULL);
     if (status != 200 && status != 204) {
       GST_DEBUG_OBJECT (whipsink, " [%u] %s\n\n", status,
-          status ? msg->reason_phrase : "HTTP error");
+          status ? gst_whip_soup_get_reason_phrase (msg) : "HTTP error");
+      _session_transition (session, GST_WHIP_SIGNALLING_EVENT_REQUEST_FAILED);
     } else {
       GST_INFO_OBJECT (whipsink, "Updating ice servers from OPTIONS response");
       const gchar *link_header =
-          soup_message_headers_get_list (msg->response_headers, "link");
-      if (link_header) {
-        GST_DEBUG_OBJECT (whipsink, "link headers :%s", link_header);
-        _update_ice_servers (whipsink, link_header);
-      }
-
-      GstPromise *promise = gst_promise_new_with_change_func (_on_offer_created,
-          (gpointer) whipsink,
-          NULL);
-      g_signal_emit_by_name ((gpointer) whipsink->webrtcbin, "create-offer",
-          NULL, promise);
+          soup_message_headers_get_list (gst_whip_soup_get_response_headers
+          (msg), "link");
+      _session_apply_link_header (session, link_header);
+      _session_create_offer (session);
     }
     g_object_unref (msg);
   }
 }
 
+static gboolean
+_apply_session_pad_priority_foreach (GstElement * element, GstPad * pad,
+    gpointer user_data)
+{
+  GstWhipSinkSession *session = user_data;
+
+  if (GST_IS_WHIP_SINK_PAD (pad) && GST_WHIP_SINK_PAD (pad)->session == session)
+    _apply_pad_priority (GST_WHIP_SINK (element), GST_WHIP_SINK_PAD (pad));
+  return TRUE;
+}
+
 static void
 _on_negotiation_needed (GstElement * webrtcbin, gpointer user_data)
 {
-  GstWhipSink *whipsink = GST_WHIP_SINK (user_data);
-  GST_DEBUG_OBJECT (whipsink, " whipsink: %p...webrtcbin :%p \n", whipsink,
-      webrtcbin);
+  GstWhipSinkSession *session = user_data;
+  GstWhipSink *whipsink = session->whipsink;
+  GST_DEBUG_OBJECT (whipsink, " whipsink: %p...session %u webrtcbin :%p \n",
+      whipsink, session->id, webrtcbin);
 
   //Set direction of the transceiver(s) to SENDONLY
   GstWebRTCRTPTransceiver *trans;
   GArray *transceivers = NULL;
   GstWebRTCRTPTransceiverDirection new_dir;
-  g_signal_emit_by_name (whipsink->webrtcbin, "get-transceivers", &transceivers,
-      NULL);
+  GstWebRTCKind kind;
+  g_signal_emit_by_name (webrtcbin, "get-transceivers", &transceivers, NULL);
   if (transceivers != NULL) {
     guint arr_len = transceivers->len;
     GST_DEBUG_OBJECT (whipsink, "transceivers array len %u", arr_len);
@@ -391,28 +852,538 @@ _on_negotiation_needed (GstElement * webrtcbin, gpointer user_data)
           GST_WEBRTC_RTP_TRANSCEIVER_DIRECTION_SENDONLY, NULL);
       g_object_get (trans, "direction", &new_dir, NULL);
       GST_DEBUG_OBJECT (whipsink, "new trans direction %d", new_dir);
+
+      //Apply the ordered codec-preferences so that the first offer is final,
+      //transceivers of pads without caps yet get them in _on_pad_caps_notify
+      g_object_get (trans, "kind", &kind, NULL);
+      if (kind == GST_WEBRTC_KIND_UNKNOWN)
+        GST_DEBUG_OBJECT (whipsink, "trans kind not known yet");
+      else
+        _apply_codec_preferences (whipsink, trans, kind);
     }
+    g_array_unref (transceivers);
   }
-  g_array_unref (transceivers);
 
+  gst_element_foreach_sink_pad (GST_ELEMENT (whipsink),
+      _apply_session_pad_priority_foreach, session);
 
   if (whipsink->use_link_headers)
-    _configure_ice_servers_from_link_headers (whipsink, TRUE);
-  else {
-    GstPromise *promise = gst_promise_new_with_change_func (_on_offer_created,
-        (gpointer) whipsink,
-        NULL);
-    g_signal_emit_by_name ((gpointer) webrtcbin, "create-offer", NULL, promise);
-  }
+    _configure_ice_servers_from_link_headers (session, TRUE);
+  else
+    _session_create_offer (session);
 }
 
 static void
 _gather_ice_candidate (GstElement * webrtc G_GNUC_UNUSED, guint mlineindex,
-    gchar * candidate, gpointer user_data G_GNUC_UNUSED)
+    gchar * candidate, gpointer user_data)
 {
-  GstWhipSink *whipsink = GST_WHIP_SINK (user_data);
+  GstWhipSinkSession *session = user_data;
+  GstWhipSink *whipsink = session->whipsink;
+  gchar **fields;
   GST_DEBUG_OBJECT (whipsink, "%u : %s", mlineindex, candidate);
   //todo add ice candidate to the queue
+
+  //candidate:foundation component transport priority address port typ type
+  fields = g_strsplit (candidate, " ", -1);
+  if (g_strv_length (fields) >= 8 &&
+      g_ascii_strcasecmp (fields[2], "UDP") == 0 &&
+      g_strcmp0 (fields[7], "host") == 0) {
+    guint16 port = g_ascii_strtoull (fields[5], NULL, 10);
+    guint i;
+
+    GST_WHIP_SINK_LOCK (whipsink);
+    for (i = 0; i < session->local_ports->len; i++) {
+      if (g_array_index (session->local_ports, guint16, i) == port)
+        break;
+    }
+    if (i == session->local_ports->len)
+      g_array_append_val (session->local_ports, port);
+    GST_WHIP_SINK_UNLOCK (whipsink);
+  }
+  g_strfreev (fields);
+}
+
+/* The port range and ICE-TCP are properties of the ICE agent of webrtcbin,
+ * which webrtcbin only exposes since GStreamer 1.22 */
+static void
+_session_configure_ice_agent (GstWhipSinkSession * session)
+{
+  GstWhipSink *whipsink = session->whipsink;
+  GObject *ice = NULL;
+
+  if (!g_object_class_find_property (G_OBJECT_GET_CLASS (session->webrtcbin),
+          "ice-agent")) {
+    if (whipsink->min_rtp_port != DEFAULT_MIN_RTP_PORT ||
+        whipsink->max_rtp_port != DEFAULT_MAX_RTP_PORT ||
+        whipsink->ice_tcp != DEFAULT_ICE_TCP)
+      GST_WARNING_OBJECT (whipsink, "webrtcbin has no ICE agent to configure");
+    return;
+  }
+  g_object_get (session->webrtcbin, "ice-agent", &ice, NULL);
+  if (ice == NULL)
+    return;
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (ice), "min-rtp-port")) {
+    if (whipsink->min_rtp_port > whipsink->max_rtp_port)
+      GST_WARNING_OBJECT (whipsink, "min-rtp-port %u > max-rtp-port %u",
+          whipsink->min_rtp_port, whipsink->max_rtp_port);
+    //the ICE agent refuses a minimum above the current maximum
+    g_object_set (ice, "min-rtp-port", 0,
+        "max-rtp-port", whipsink->max_rtp_port,
+        "min-rtp-port", whipsink->min_rtp_port, NULL);
+  } else if (whipsink->min_rtp_port != DEFAULT_MIN_RTP_PORT ||
+      whipsink->max_rtp_port != DEFAULT_MAX_RTP_PORT) {
+    GST_WARNING_OBJECT (whipsink, "the ICE agent has no port range");
+  }
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (ice), "ice-tcp"))
+    g_object_set (ice, "ice-tcp", whipsink->ice_tcp, NULL);
+  else if (!whipsink->ice_tcp)
+    GST_WARNING_OBJECT (whipsink, "ICE-TCP cannot be disabled");
+
+  gst_object_unref (ice);
+}
+
+static void
+_set_transport_buffer_sizes (GstWhipSink * whipsink,
+    GstWebRTCDTLSTransport * dtls, guint send_size, guint receive_size)
+{
+  GstWebRTCICETransport *transport = NULL;
+
+  if (dtls == NULL)
+    return;
+  g_object_get (dtls, "transport", &transport, NULL);
+  if (transport == NULL)
+    return;
+
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (transport),
+          "send-buffer-size")) {
+    if (send_size)
+      g_object_set (transport, "send-buffer-size", send_size, NULL);
+    if (receive_size)
+      g_object_set (transport, "receive-buffer-size", receive_size, NULL);
+  } else {
+    GST_WARNING_OBJECT (whipsink, "cannot set the socket buffer sizes");
+  }
+  gst_object_unref (transport);
+}
+
+/* The transports exist once gathering starts, and the buffer sizes are
+ * applied to the sockets when a candidate pair gets selected */
+static void
+_on_ice_gathering_state_change (GstElement * webrtcbin,
+    GParamSpec * pspec G_GNUC_UNUSED, gpointer user_data)
+{
+  GstWhipSinkSession *session = user_data;
+  GstWhipSink *whipsink = session->whipsink;
+  GstWebRTCICEGatheringState state;
+  GArray *transceivers = NULL;
+  guint send_size, receive_size, i;
+
+  g_object_get (webrtcbin, "ice-gathering-state", &state, NULL);
+  if (state != GST_WEBRTC_ICE_GATHERING_STATE_GATHERING)
+    return;
+
+  GST_WHIP_SINK_LOCK (whipsink);
+  send_size = whipsink->send_buffer_size;
+  receive_size = whipsink->receive_buffer_size;
+  GST_WHIP_SINK_UNLOCK (whipsink);
+  if (send_size == 0 && receive_size == 0)
+    return;
+
+  GST_DEBUG_OBJECT (whipsink, "session %u socket buffer sizes %u/%u",
+      session->id, send_size, receive_size);
+  g_signal_emit_by_name (webrtcbin, "get-transceivers", &transceivers);
+  if (transceivers == NULL)
+    return;
+  for (i = 0; i < transceivers->len; i++) {
+    GstWebRTCRTPTransceiver *trans =
+        g_array_index (transceivers, GstWebRTCRTPTransceiver *, i);
+
+    if (trans->sender)
+      _set_transport_buffer_sizes (whipsink, trans->sender->transport,
+          send_size, receive_size);
+  }
+  g_array_unref (transceivers);
+}
+
+static GstWhipSinkSession *
+_session_new (GstWhipSink * whipsink, guint id)
+{
+  GstWhipSinkSession *session = g_new0 (GstWhipSinkSession, 1);
+  gchar *name;
+
+  session->ref_count = 1;
+  session->whipsink = whipsink;
+  session->id = id;
+
+  if (id == 0)
+    name = g_strdup ("whip-webrtcbin");
+  else
+    name = g_strdup_printf ("whip-webrtcbin-%u", id);
+  session->webrtcbin = gst_element_factory_make ("webrtcbin", name);
+  g_free (name);
+
+  if (whipsink->webrtcbin) {
+    //share the configuration of the default session
+    gchar *stun_svr = NULL, *turn_svr = NULL;
+    GstWebRTCBundlePolicy bundle_policy;
+
+    g_object_get (whipsink->webrtcbin, "stun-server", &stun_svr,
+        "turn-server", &turn_svr, "bundle-policy", &bundle_policy, NULL);
+    g_object_set (session->webrtcbin, "bundle-policy", bundle_policy, NULL);
+    if (stun_svr)
+      g_object_set (session->webrtcbin, "stun-server", stun_svr, NULL);
+    if (turn_svr)
+      g_object_set (session->webrtcbin, "turn-server", turn_svr, NULL);
+    g_free (stun_svr);
+    g_free (turn_svr);
+  }
+
+  session->local_ports = g_array_new (FALSE, FALSE, sizeof (guint16));
+  _session_configure_ice_agent (session);
+
+  gst_bin_add (GST_BIN (whipsink), session->webrtcbin);
+  g_signal_connect (session->webrtcbin, "on-negotiation-needed",
+      G_CALLBACK (_on_negotiation_needed), (gpointer) session);
+  g_signal_connect (session->webrtcbin, "on-ice-candidate",
+      G_CALLBACK (_gather_ice_candidate), (gpointer) session);
+  g_signal_connect (session->webrtcbin, "notify::ice-gathering-state",
+      G_CALLBACK (_on_ice_gathering_state_change), (gpointer) session);
+
+  g_hash_table_insert (whipsink->sessions, GUINT_TO_POINTER (id), session);
+  if (id >= whipsink->next_session_id)
+    whipsink->next_session_id = id + 1;
+
+  GST_DEBUG_OBJECT (whipsink, "created session %u", id);
+
+  return session;
+}
+
+static void
+_session_free (GstWhipSinkSession * session)
+{
+  g_free (session->whip_endpoint);
+  g_free (session->resource_url);
+  g_array_unref (session->local_ports);
+  g_free (session);
+}
+
+static void
+_session_delete_resource (GstWhipSinkSession * session)
+{
+  GstWhipSink *whipsink = session->whipsink;
+  SoupMessage *msg;
+  gchar *resource_url;
+
+  _session_transition (session, GST_WHIP_SIGNALLING_EVENT_TERMINATE);
+  GST_WHIP_SINK_LOCK (whipsink);
+  resource_url = g_steal_pointer (&session->resource_url);
+  GST_WHIP_SINK_UNLOCK (whipsink);
+  if (resource_url == NULL || whipsink->soup_session == NULL) {
+    g_free (resource_url);
+    return;
+  }
+
+  msg = soup_message_new ("DELETE", resource_url);
+  guint status = gst_whip_soup_send (whipsink->soup_session, msg, NULL);
+  GST_DEBUG_OBJECT (whipsink, "session %u delete return %u", session->id,
+      status);
+  g_object_unref (msg);
+  _session_transition (session, SOUP_STATUS_IS_SUCCESSFUL (status) ?
+      GST_WHIP_SIGNALLING_EVENT_TERMINATED :
+      GST_WHIP_SIGNALLING_EVENT_REQUEST_FAILED);
+
+  g_free (resource_url);
+}
+
+/* Tear down a session which has no pads anymore. Stopping webrtcbin joins
+ * its thread, so an offer POSTed meanwhile has stored its resource url by
+ * the time the resource gets deleted. Must be called without the lock */
+static void
+_session_remove (GstWhipSink * whipsink, GstWhipSinkSession * session)
+{
+  GST_DEBUG_OBJECT (whipsink, "removing session %u", session->id);
+
+  g_atomic_int_set (&session->removed, TRUE);
+  g_signal_handlers_disconnect_by_data (session->webrtcbin, session);
+  gst_element_set_locked_state (session->webrtcbin, TRUE);
+  gst_element_set_state (session->webrtcbin, GST_STATE_NULL);
+  _session_delete_resource (session);
+  gst_bin_remove (GST_BIN (whipsink), session->webrtcbin);
+  _session_unref (session);
+}
+
+static guint
+_count_elements (GstElement * webrtcbin)
+{
+  GstIterator *it = gst_bin_iterate_recurse (GST_BIN (webrtcbin));
+  GValue item = G_VALUE_INIT;
+  gboolean done = FALSE;
+  guint n = 1;
+
+  while (!done) {
+    switch (gst_iterator_next (it, &item)) {
+      case GST_ITERATOR_OK:
+        n++;
+        g_value_reset (&item);
+        break;
+      case GST_ITERATOR_RESYNC:
+        n = 1;
+        gst_iterator_resync (it);
+        break;
+      default:
+        done = TRUE;
+        break;
+    }
+  }
+  g_value_unset (&item);
+  gst_iterator_free (it);
+
+  return n;
+}
+
+static GstStructure *
+_create_stats (GstWhipSink * whipsink)
+{
+  GstStructure *stats;
+  GHashTableIter iter;
+  gpointer value;
+  guint64 sndbuf_errors, rcvbuf_errors;
+  gboolean have_buffer_errors;
+  GHashTable *udp_drops;
+
+  //the socket tables can be large, read them once and outside of the lock
+  have_buffer_errors =
+      gst_whip_get_udp_buffer_errors (&sndbuf_errors, &rcvbuf_errors);
+  udp_drops = gst_whip_read_udp_socket_drops ();
+
+  GST_WHIP_SINK_LOCK (whipsink);
+  stats = gst_structure_new ("application/x-whipsink-stats",
+      "n-sessions", G_TYPE_UINT, g_hash_table_size (whipsink->sessions), NULL);
+  //send buffer overflows are only counted system wide
+  if (have_buffer_errors)
+    gst_structure_set (stats, "udp-sndbuf-errors", G_TYPE_UINT64,
+        sndbuf_errors, "udp-rcvbuf-errors", G_TYPE_UINT64, rcvbuf_errors,
+        NULL);
+
+  g_hash_table_iter_init (&iter, whipsink->sessions);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    GstWhipSinkSession *session = value;
+    GstWebRTCPeerConnectionState connection_state;
+    guint64 dropped_frames = 0, dropped_buffers = 0, keyframe_requests = 0;
+    GstStructure *s;
+    gchar *field;
+    GList *l;
+    guint i;
+
+    GST_OBJECT_LOCK (whipsink);
+    for (l = GST_ELEMENT (whipsink)->sinkpads; l; l = l->next) {
+      GstWhipSinkPad *pad = l->data;
+
+      if (!GST_IS_WHIP_SINK_PAD (pad) || pad->session != session)
+        continue;
+      GST_OBJECT_LOCK (pad);
+      dropped_frames += pad->dropped_frames;
+      dropped_buffers += pad->dropped_buffers;
+      keyframe_requests += pad->keyframe_requests;
+      GST_OBJECT_UNLOCK (pad);
+    }
+    GST_OBJECT_UNLOCK (whipsink);
+
+    g_object_get (session->webrtcbin, "connection-state", &connection_state,
+        NULL);
+    //the elements making up the session are its per-session overhead
+    s = gst_structure_new ("application/x-whipsink-session-stats",
+        "id", G_TYPE_UINT, session->id,
+        "n-pads", G_TYPE_UINT, session->n_pads,
+        "n-elements", G_TYPE_UINT, _count_elements (session->webrtcbin),
+        "connection-state", GST_TYPE_WEBRTC_PEER_CONNECTION_STATE,
+        connection_state, "signalling-state", G_TYPE_STRING,
+        gst_whip_signalling_state_get_name (session->signalling_state),
+        //copied while the lock keeps _send_sdp from replacing it
+        "resource-url", G_TYPE_STRING, session->resource_url,
+        "dropped-frames", G_TYPE_UINT64, dropped_frames,
+        "dropped-buffers", G_TYPE_UINT64, dropped_buffers,
+        "keyframe-requests", G_TYPE_UINT64, keyframe_requests, NULL);
+
+    //the drops of the sockets of the session, on the receive side only
+    if (udp_drops) {
+      guint64 receive_drops = 0;
+
+      for (i = 0; i < session->local_ports->len; i++) {
+        guint64 *port_drops = g_hash_table_lookup (udp_drops,
+            GUINT_TO_POINTER (g_array_index (session->local_ports, guint16,
+                    i)));
+        if (port_drops)
+          receive_drops += *port_drops;
+      }
+      gst_structure_set (s, "udp-receive-drops", G_TYPE_UINT64,
+          receive_drops, NULL);
+    }
+    field = g_strdup_printf ("session-%u", session->id);
+    gst_structure_set (stats, field, GST_TYPE_STRUCTURE, s, NULL);
+    gst_structure_free (s);
+    g_free (field);
+  }
+  GST_WHIP_SINK_UNLOCK (whipsink);
+
+  if (udp_drops)
+    g_hash_table_unref (udp_drops);
+
+  return stats;
+}
+
+/* pad class */
+
+G_DEFINE_TYPE (GstWhipSinkPad, gst_whip_sink_pad, GST_TYPE_GHOST_PAD);
+
+static void
+gst_whip_sink_pad_set_property (GObject * object, guint property_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstWhipSinkPad *pad = GST_WHIP_SINK_PAD (object);
+  GstElement *parent;
+
+  switch (property_id) {
+    case PROP_PAD_PRIORITY:
+      GST_OBJECT_LOCK (pad);
+      pad->priority = g_value_get_enum (value);
+      pad->priority_set = TRUE;
+      GST_OBJECT_UNLOCK (pad);
+
+      parent = gst_pad_get_parent_element (GST_PAD (pad));
+      if (parent) {
+        _apply_pad_priority (GST_WHIP_SINK (parent), pad);
+        gst_object_unref (parent);
+      }
+      break;
+    case PROP_PAD_WHIP_ENDPOINT:
+      parent = gst_pad_get_parent_element (GST_PAD (pad));
+      if (parent) {
+        GST_WHIP_SINK_LOCK (GST_WHIP_SINK (parent));
+        g_free (pad->session->whip_endpoint);
+        pad->session->whip_endpoint = g_value_dup_string (value);
+        GST_WHIP_SINK_UNLOCK (GST_WHIP_SINK (parent));
+        gst_object_unref (parent);
+      }
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_whip_sink_pad_get_property (GObject * object, guint property_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstWhipSinkPad *pad = GST_WHIP_SINK_PAD (object);
+
+  switch (property_id) {
+    case PROP_PAD_PRIORITY:
+    {
+      GstElement *parent = gst_pad_get_parent_element (GST_PAD (pad));
+
+      //report what the sender got when no priority was set on the pad
+      if (parent) {
+        GstWebRTCRTPTransceiver *trans = _get_pad_transceiver (pad);
+
+        g_value_set_enum (value,
+            _get_pad_priority (GST_WHIP_SINK (parent), pad, trans));
+        if (trans)
+          gst_object_unref (trans);
+        gst_object_unref (parent);
+      } else {
+        GST_OBJECT_LOCK (pad);
+        g_value_set_enum (value, pad->priority);
+        GST_OBJECT_UNLOCK (pad);
+      }
+      break;
+    }
+    case PROP_PAD_WHIP_ENDPOINT:
+      g_value_set_string (value,
+          pad->session ? pad->session->whip_endpoint : NULL);
+      break;
+    case PROP_PAD_DROPPED_FRAMES:
+      GST_OBJECT_LOCK (pad);
+      g_value_set_uint64 (value, pad->dropped_frames);
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    case PROP_PAD_DROPPED_BUFFERS:
+      GST_OBJECT_LOCK (pad);
+      g_value_set_uint64 (value, pad->dropped_buffers);
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    case PROP_PAD_KEYFRAME_REQUESTS:
+      GST_OBJECT_LOCK (pad);
+      g_value_set_uint64 (value, pad->keyframe_requests);
+      GST_OBJECT_UNLOCK (pad);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_whip_sink_pad_finalize (GObject * object)
+{
+  GstWhipSinkPad *pad = GST_WHIP_SINK_PAD (object);
+
+  gst_clear_object (&pad->webrtcbin_pad);
+  G_OBJECT_CLASS (gst_whip_sink_pad_parent_class)->finalize (object);
+}
+
+static void
+gst_whip_sink_pad_class_init (GstWhipSinkPadClass * klass)
+{
+  GObjectClass *gobject_class = G_OBJECT_CLASS (klass);
+
+  gobject_class->set_property = gst_whip_sink_pad_set_property;
+  gobject_class->get_property = gst_whip_sink_pad_get_property;
+  gobject_class->finalize = gst_whip_sink_pad_finalize;
+
+  g_object_class_install_property (gobject_class,
+      PROP_PAD_PRIORITY,
+      g_param_spec_enum ("priority", "Priority",
+          "The network priority of this track, used for DSCP marking. "
+          "If not set, the audio-priority or video-priority of the element "
+          "is used depending on the media kind",
+          GST_TYPE_WEBRTC_PRIORITY_TYPE, GST_WEBRTC_PRIORITY_TYPE_LOW,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_PAD_WHIP_ENDPOINT,
+      g_param_spec_string ("whip-endpoint", "WHIP Endpoint",
+          "The WHIP server endpoint of the session of this pad. "
+          "If not set, the whip-endpoint of the element is used",
+          NULL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_PAD_DROPPED_FRAMES,
+      g_param_spec_uint64 ("dropped-frames", "Dropped Frames",
+          "The number of frames dropped because of max-latency",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_PAD_DROPPED_BUFFERS,
+      g_param_spec_uint64 ("dropped-buffers", "Dropped Buffers",
+          "The number of RTP packets dropped because of max-latency",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_PAD_KEYFRAME_REQUESTS,
+      g_param_spec_uint64 ("keyframe-requests", "Keyframe Requests",
+          "The number of keyframes requested upstream after dropping frames",
+          0, G_MAXUINT64, 0, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_whip_sink_pad_init (GstWhipSinkPad * pad)
+{
+  pad->priority = GST_WEBRTC_PRIORITY_TYPE_LOW;
+  pad->priority_set = FALSE;
 }
 
 /* class initialization */
@@ -439,8 +1410,10 @@ gst_whip_sink_class_init (GstWhipSinkClass * klass)
   // gstelement_class->change_state =
   //     GST_DEBUG_FUNCPTR(gst_whip_sink_change_state);
 
-  gst_element_class_add_static_pad_template (GST_ELEMENT_CLASS (klass),
-      &gst_whip_sink_sink_template);
+  gst_element_class_add_static_pad_template_with_gtype (GST_ELEMENT_CLASS
+      (klass), &gst_whip_sink_sink_template, GST_TYPE_WHIP_SINK_PAD);
+  gst_element_class_add_static_pad_template_with_gtype (GST_ELEMENT_CLASS
+      (klass), &gst_whip_sink_session_sink_template, GST_TYPE_WHIP_SINK_PAD);
 
   gst_element_class_set_static_metadata (GST_ELEMENT_CLASS (klass),
       "WHIP Bin", "Sink/Network/WebRTC",
@@ -488,24 +1461,134 @@ gst_whip_sink_class_init (GstWhipSinkClass * klass)
           TRUE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
           | GST_PARAM_MUTABLE_READY));
 
+  g_object_class_install_property (gobject_class,
+      PROP_CODEC_PREFERENCES,
+      g_param_spec_boxed ("codec-preferences", "Codec Preferences",
+          "Ordered list of RTP caps to offer, most preferred first. "
+          "e.g.: application/x-rtp,media=video,encoding-name=H264,payload=102; "
+          "application/x-rtp,media=video,encoding-name=VP8,payload=96. "
+          "Caps passed when requesting a pad are restricted to and ordered "
+          "by these.",
+          GST_TYPE_CAPS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_AUDIO_PRIORITY,
+      g_param_spec_enum ("audio-priority", "Audio Priority",
+          "The default network priority of audio tracks, used for DSCP "
+          "marking. Can be overridden with the priority property of a pad",
+          GST_TYPE_WEBRTC_PRIORITY_TYPE, DEFAULT_AUDIO_PRIORITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_VIDEO_PRIORITY,
+      g_param_spec_enum ("video-priority", "Video Priority",
+          "The default network priority of video tracks, used for DSCP "
+          "marking. Can be overridden with the priority property of a pad",
+          GST_TYPE_WEBRTC_PRIORITY_TYPE, DEFAULT_VIDEO_PRIORITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MAX_LATENCY,
+      g_param_spec_uint ("max-latency", "Maximum Latency",
+          "The maximum time in ms the RTP packets of a pad may be queued "
+          "before whole frames are dropped, 0 to never drop. Applies to the "
+          "pads requested afterwards",
+          0, G_MAXUINT, DEFAULT_MAX_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MIN_RTP_PORT,
+      g_param_spec_uint ("min-rtp-port", "Minimum RTP Port",
+          "The minimum local port of the ICE candidates",
+          0, 65535, DEFAULT_MIN_RTP_PORT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_MAX_RTP_PORT,
+      g_param_spec_uint ("max-rtp-port", "Maximum RTP Port",
+          "The maximum local port of the ICE candidates",
+          0, 65535, DEFAULT_MAX_RTP_PORT,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_ICE_TCP,
+      g_param_spec_boolean ("ice-tcp", "ICE-TCP",
+          "Whether to gather TCP candidates besides the UDP ones",
+          DEFAULT_ICE_TCP, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_SEND_BUFFER_SIZE,
+      g_param_spec_uint ("send-buffer-size", "Send Buffer Size",
+          "The size in bytes of the kernel send buffer of the sockets, "
+          "0 for the system default. Raise it to absorb keyframe bursts at "
+          "high bitrates",
+          0, G_MAXINT, DEFAULT_SEND_BUFFER_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_RECEIVE_BUFFER_SIZE,
+      g_param_spec_uint ("receive-buffer-size", "Receive Buffer Size",
+          "The size in bytes of the kernel receive buffer of the sockets, "
+          "0 for the system default",
+          0, G_MAXINT, DEFAULT_RECEIVE_BUFFER_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS
+          | GST_PARAM_MUTABLE_READY));
+
+  g_object_class_install_property (gobject_class,
+      PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Statistics of the WHIP sessions hosted by this element. "
+          "udp-receive-drops counts the datagrams dropped by the kernel on "
+          "the receive side of the sockets of a session, datagrams dropped "
+          "for lack of send buffer space are only counted host wide in "
+          "udp-sndbuf-errors",
+          GST_TYPE_STRUCTURE, G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
 }
 
 static void
 gst_whip_sink_init (GstWhipSink * whipsink)
 {
-  whipsink->webrtcbin =
-      gst_element_factory_make ("webrtcbin", "whip-webrtcbin");
-  gst_bin_add (GST_BIN (whipsink), whipsink->webrtcbin);
-  g_signal_connect (whipsink->webrtcbin, "on-negotiation-needed",
-      G_CALLBACK (_on_negotiation_needed), (gpointer) whipsink);
+  GstWhipSinkSession *session;
+
+  whipsink->sessions = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+      NULL, (GDestroyNotify) _session_unref);
+  whipsink->next_session_id = 0;
+  whipsink->link_header = NULL;
+  whipsink->min_rtp_port = DEFAULT_MIN_RTP_PORT;
+  whipsink->max_rtp_port = DEFAULT_MAX_RTP_PORT;
+  whipsink->ice_tcp = DEFAULT_ICE_TCP;
+  whipsink->send_buffer_size = DEFAULT_SEND_BUFFER_SIZE;
+  whipsink->receive_buffer_size = DEFAULT_RECEIVE_BUFFER_SIZE;
+
+  //the default session, used by the sink_%u pads
+  session = _session_new (whipsink, 0);
+  whipsink->webrtcbin = session->webrtcbin;
+
+  whipsink->codec_preferences = NULL;
+  whipsink->audio_priority = DEFAULT_AUDIO_PRIORITY;
+  whipsink->video_priority = DEFAULT_VIDEO_PRIORITY;
+  whipsink->max_latency = DEFAULT_MAX_LATENCY;
+  whipsink->soup_session = gst_whip_soup_session_get ();
+}
 
-  whipsink->resource_url = NULL;
-  whipsink->soup_session = soup_session_new_with_options ("timeout", 30, NULL);
-  // g_signal_connect (whipsink->webrtcbin, "on-ice-candidate",
-  //     G_CALLBACK (_gather_ice_candidate);
-  // g_signal_connect (whipsink->webrtcbin, "notify::ice-gathering-state",
-  //     G_CALLBACK (_on_ice_gathering_state_change), whipsink);
+static void
+_set_sessions_property (GstWhipSink * whipsink, const gchar * name,
+    const GValue * value)
+{
+  GHashTableIter iter;
+  gpointer session;
 
+  g_hash_table_iter_init (&iter, whipsink->sessions);
+  while (g_hash_table_iter_next (&iter, NULL, &session))
+    g_object_set_property ((GObject *) ((GstWhipSinkSession *)
+            session)->webrtcbin, name, value);
 }
 
 void
@@ -523,22 +1606,19 @@ gst_whip_sink_set_property (GObject * object, guint property_id,
       break;
     case PROP_STUN_SERVER:
       GST_WHIP_SINK_LOCK (whipsink);
-      g_object_set_property ((GObject *) whipsink->webrtcbin, "stun-server",
-          value);
+      _set_sessions_property (whipsink, "stun-server", value);
       GST_WHIP_SINK_UNLOCK (whipsink);
       break;
 
     case PROP_TURN_SERVER:
       GST_WHIP_SINK_LOCK (whipsink);
-      g_object_set_property ((GObject *) whipsink->webrtcbin, "turn-server",
-          value);
+      _set_sessions_property (whipsink, "turn-server", value);
       GST_WHIP_SINK_UNLOCK (whipsink);
       break;
 
     case PROP_BUNDLE_POLICY:
       GST_WHIP_SINK_LOCK (whipsink);
-      g_object_set_property ((GObject *) whipsink->webrtcbin, "bundle-policy",
-          value);
+      _set_sessions_property (whipsink, "bundle-policy", value);
       GST_WHIP_SINK_UNLOCK (whipsink);
       break;
 
@@ -548,6 +1628,68 @@ gst_whip_sink_set_property (GObject * object, guint property_id,
       GST_WHIP_SINK_UNLOCK (whipsink);
       break;
 
+    case PROP_CODEC_PREFERENCES:
+      GST_WHIP_SINK_LOCK (whipsink);
+      gst_caps_replace (&whipsink->codec_preferences,
+          (GstCaps *) gst_value_get_caps (value));
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+
+    case PROP_AUDIO_PRIORITY:
+      GST_WHIP_SINK_LOCK (whipsink);
+      whipsink->audio_priority = g_value_get_enum (value);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      gst_element_foreach_sink_pad (GST_ELEMENT (whipsink),
+          _apply_pad_priority_foreach, NULL);
+      break;
+
+    case PROP_VIDEO_PRIORITY:
+      GST_WHIP_SINK_LOCK (whipsink);
+      whipsink->video_priority = g_value_get_enum (value);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      gst_element_foreach_sink_pad (GST_ELEMENT (whipsink),
+          _apply_pad_priority_foreach, NULL);
+      break;
+
+    case PROP_MAX_LATENCY:
+      GST_WHIP_SINK_LOCK (whipsink);
+      whipsink->max_latency = g_value_get_uint (value);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+
+    case PROP_MIN_RTP_PORT:
+    case PROP_MAX_RTP_PORT:
+    case PROP_ICE_TCP:
+    {
+      GHashTableIter iter;
+      gpointer session;
+
+      GST_WHIP_SINK_LOCK (whipsink);
+      if (property_id == PROP_MIN_RTP_PORT)
+        whipsink->min_rtp_port = g_value_get_uint (value);
+      else if (property_id == PROP_MAX_RTP_PORT)
+        whipsink->max_rtp_port = g_value_get_uint (value);
+      else
+        whipsink->ice_tcp = g_value_get_boolean (value);
+      g_hash_table_iter_init (&iter, whipsink->sessions);
+      while (g_hash_table_iter_next (&iter, NULL, &session))
+        _session_configure_ice_agent (session);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    }
+
+    case PROP_SEND_BUFFER_SIZE:
+      GST_WHIP_SINK_LOCK (whipsink);
+      whipsink->send_buffer_size = g_value_get_uint (value);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+
+    case PROP_RECEIVE_BUFFER_SIZE:
+      GST_WHIP_SINK_LOCK (whipsink);
+      whipsink->receive_buffer_size = g_value_get_uint (value);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -590,6 +1732,54 @@ gst_whip_sink_get_property (GObject * object, guint property_id,
     case PROP_USE_LINK_HEADERS:
       g_value_set_boolean (value, whipsink->use_link_headers);
       break;
+    case PROP_CODEC_PREFERENCES:
+      GST_WHIP_SINK_LOCK (whipsink);
+      gst_value_set_caps (value, whipsink->codec_preferences);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_AUDIO_PRIORITY:
+      GST_WHIP_SINK_LOCK (whipsink);
+      g_value_set_enum (value, whipsink->audio_priority);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_VIDEO_PRIORITY:
+      GST_WHIP_SINK_LOCK (whipsink);
+      g_value_set_enum (value, whipsink->video_priority);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_MAX_LATENCY:
+      GST_WHIP_SINK_LOCK (whipsink);
+      g_value_set_uint (value, whipsink->max_latency);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_MIN_RTP_PORT:
+      GST_WHIP_SINK_LOCK (whipsink);
+      g_value_set_uint (value, whipsink->min_rtp_port);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_MAX_RTP_PORT:
+      GST_WHIP_SINK_LOCK (whipsink);
+      g_value_set_uint (value, whipsink->max_rtp_port);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_ICE_TCP:
+      GST_WHIP_SINK_LOCK (whipsink);
+      g_value_set_boolean (value, whipsink->ice_tcp);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_SEND_BUFFER_SIZE:
+      GST_WHIP_SINK_LOCK (whipsink);
+      g_value_set_uint (value, whipsink->send_buffer_size);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_RECEIVE_BUFFER_SIZE:
+      GST_WHIP_SINK_LOCK (whipsink);
+      g_value_set_uint (value, whipsink->receive_buffer_size);
+      GST_WHIP_SINK_UNLOCK (whipsink);
+      break;
+    case PROP_STATS:
+      g_value_take_boxed (value, _create_stats (whipsink));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
       break;
@@ -602,18 +1792,14 @@ gst_whip_sink_dispose (GObject * object)
 {
 
   GstWhipSink *whipsink = GST_WHIP_SINK (object);
-  SoupMessage *msg;
+  GHashTableIter iter;
+  gpointer session;
 
-  if (whipsink->resource_url && whipsink->soup_session) {
-    msg = soup_message_new ("DELETE", whipsink->resource_url);
-    guint status = soup_session_send_message (whipsink->soup_session, msg);
-    g_print ("%s delete return %d : %s\n", __func__, status,
-        msg->response_body->data);
-    g_object_unref (msg);
-  }
+  g_hash_table_iter_init (&iter, whipsink->sessions);
+  while (g_hash_table_iter_next (&iter, NULL, &session))
+    _session_delete_resource ((GstWhipSinkSession *) session);
 
-  g_object_unref ((gpointer) whipsink->soup_session);
-  g_free (whipsink->resource_url);
+  g_clear_object (&whipsink->soup_session);
   G_OBJECT_CLASS (parent_class)->dispose (object);
 
 }
@@ -621,6 +1807,11 @@ gst_whip_sink_dispose (GObject * object)
 void
 gst_whip_sink_finalize (GObject * object)
 {
+  GstWhipSink *whipsink = GST_WHIP_SINK (object);
+
+  gst_caps_replace (&whipsink->codec_preferences, NULL);
+  g_hash_table_unref (whipsink->sessions);
+  g_free (whipsink->link_header);
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -629,16 +1820,93 @@ gst_whip_sink_request_new_pad (GstElement * element,
     GstPadTemplate * templ, const gchar * name, const GstCaps * caps)
 {
   GstWhipSink *whipsink = GST_WHIP_SINK (element);
-  GstPad *sinkpad;
-  GST_DEBUG_OBJECT (whipsink, "templ:%s, name:%s", templ->name_template, name);
+  GstWhipSinkSession *session;
+  GstPad *sinkpad, *target;
+  GstPadTemplate *wb_templ;
+  GstCaps *prefs;
+  gboolean new_session = FALSE;
+  guint session_id = 0, sink_id;
+  gchar *wb_name = NULL;
+  GST_DEBUG_OBJECT (whipsink, "templ:%s, name:%s caps:%" GST_PTR_FORMAT,
+      templ->name_template, name, caps);
 
   GST_WHIP_SINK_LOCK (whipsink);
+  if (g_strcmp0 (templ->name_template, "session_%u_sink_%u") == 0) {
+    if (name && sscanf (name, "session_%u_sink_%u", &session_id,
+            &sink_id) == 2) {
+      wb_name = g_strdup_printf ("sink_%u", sink_id);
+    } else {
+      session_id = whipsink->next_session_id;
+    }
+  } else {
+    wb_name = g_strdup (name);
+  }
+
+  session = g_hash_table_lookup (whipsink->sessions,
+      GUINT_TO_POINTER (session_id));
+  if (session == NULL) {
+    session = _session_new (whipsink, session_id);
+    new_session = TRUE;
+  }
+
+  prefs = _get_pad_codec_preferences (whipsink, caps);
+  wb_templ = gst_element_get_pad_template (session->webrtcbin, "sink_%u");
   GstPad *wb_sink_pad =
-      gst_element_request_pad_simple (whipsink->webrtcbin, "sink_%u");
-  sinkpad = gst_ghost_pad_new (gst_pad_get_name (wb_sink_pad), wb_sink_pad);
+      gst_element_request_pad (session->webrtcbin, wb_templ, wb_name, prefs);
+  g_free (wb_name);
+  if (wb_sink_pad == NULL) {
+    GST_ERROR_OBJECT (whipsink, "failed to request pad from webrtcbin");
+    gst_clear_caps (&prefs);
+    if (new_session)
+      g_hash_table_steal (whipsink->sessions, GUINT_TO_POINTER (session_id));
+    GST_WHIP_SINK_UNLOCK (whipsink);
+    //removing a session takes the lock to update its signalling state
+    if (new_session)
+      _session_remove (whipsink, session);
+    return NULL;
+  }
+
+  if (prefs) {
+    GstWebRTCRTPTransceiver *trans = NULL;
+
+    //make sure the transceiver offers these codecs and nothing else
+    g_object_get (wb_sink_pad, "transceiver", &trans, NULL);
+    if (trans) {
+      GST_DEBUG_OBJECT (whipsink, "codec preferences %" GST_PTR_FORMAT, prefs);
+      g_object_set (trans, "codec-preferences", prefs, NULL);
+      gst_object_unref (trans);
+    }
+    gst_caps_unref (prefs);
+  }
+
+  gchar *pad_name;
+  if (session->id == 0)
+    pad_name = gst_pad_get_name (wb_sink_pad);
+  else
+    pad_name = g_strdup_printf ("session_%u_%s", session->id,
+        GST_PAD_NAME (wb_sink_pad));
+  sinkpad = g_object_new (GST_TYPE_WHIP_SINK_PAD, "name", pad_name,
+      "direction", GST_PAD_SINK, "template", templ, NULL);
+  g_free (pad_name);
+  GST_WHIP_SINK_PAD (sinkpad)->session = session;
+  GST_WHIP_SINK_PAD (sinkpad)->webrtcbin_pad = wb_sink_pad;
+  g_signal_connect (sinkpad, "notify::caps", G_CALLBACK (_on_pad_caps_notify),
+      whipsink);
+  session->n_pads++;
+  if (whipsink->max_latency > 0)
+    target = _add_admission_stage (whipsink, GST_WHIP_SINK_PAD (sinkpad),
+        wb_sink_pad, whipsink->max_latency * GST_MSECOND);
+  else
+    target = gst_object_ref (wb_sink_pad);
+  gst_ghost_pad_set_target (GST_GHOST_PAD (sinkpad), target);
+  gst_object_unref (target);
   gst_element_add_pad (GST_ELEMENT_CAST (whipsink), sinkpad);
-  gst_object_unref (wb_sink_pad);
   GST_WHIP_SINK_UNLOCK (whipsink);
+
+  if (new_session)
+    gst_element_sync_state_with_parent (session->webrtcbin);
+
+  _apply_pad_priority (whipsink, GST_WHIP_SINK_PAD (sinkpad));
   return sinkpad;
 }
 
@@ -646,15 +1914,36 @@ static void
 gst_whip_sink_release_pad (GstElement * element, GstPad * pad)
 {
   GstWhipSink *whipsink = GST_WHIP_SINK (element);
+  GstWhipSinkSession *session = GST_WHIP_SINK_PAD (pad)->session;
+  gboolean remove_session = FALSE;
   GST_DEBUG_OBJECT (whipsink, "releasing request pad");
   GST_INFO_OBJECT (pad, "releasing request pad");
   GST_WHIP_SINK_LOCK (whipsink);
 
-  GstPad *wbin_pad = gst_pad_get_peer (pad);
-  gst_element_release_request_pad (whipsink->webrtcbin, wbin_pad);
-  gst_object_unref (wbin_pad);
+  GstWhipSinkPad *whip_pad = GST_WHIP_SINK_PAD (pad);
+  if (whip_pad->queue) {
+    gst_element_set_locked_state (whip_pad->queue, TRUE);
+    gst_element_set_state (whip_pad->queue, GST_STATE_NULL);
+    gst_bin_remove (GST_BIN (whipsink), whip_pad->queue);
+    whip_pad->queue = NULL;
+  }
+  if (whip_pad->webrtcbin_pad) {
+    gst_element_release_request_pad (session->webrtcbin,
+        whip_pad->webrtcbin_pad);
+    gst_clear_object (&whip_pad->webrtcbin_pad);
+  }
   gst_element_remove_pad (element, pad);
+
+  //the default session lives as long as the element
+  session->n_pads--;
+  if (session->n_pads == 0 && session->id != 0) {
+    g_hash_table_steal (whipsink->sessions, GUINT_TO_POINTER (session->id));
+    remove_session = TRUE;
+  }
   GST_WHIP_SINK_UNLOCK (whipsink);
+
+  if (remove_session)
+    _session_remove (whipsink, session);
 }
 
 static void
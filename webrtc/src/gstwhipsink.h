@@ -31,6 +31,8 @@
 #include <libsoup/soup.h>
 #include <string.h>
 
+#include "gstwhipsignalling.h"
+
 G_BEGIN_DECLS
 #define GST_TYPE_WHIP_SINK   (gst_whip_sink_get_type())
 #define GST_WHIP_SINK(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_WHIP_SINK,GstWhipSink))
@@ -40,18 +42,85 @@ G_BEGIN_DECLS
 typedef struct _GstWhipSink GstWhipSink;
 typedef struct _GstWhipSinkClass GstWhipSinkClass;
 
+#define GST_TYPE_WHIP_SINK_PAD   (gst_whip_sink_pad_get_type())
+#define GST_WHIP_SINK_PAD(obj)   (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_WHIP_SINK_PAD,GstWhipSinkPad))
+#define GST_IS_WHIP_SINK_PAD(obj)   (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_WHIP_SINK_PAD))
+typedef struct _GstWhipSinkPad GstWhipSinkPad;
+typedef struct _GstWhipSinkPadClass GstWhipSinkPadClass;
+typedef struct _GstWhipSinkSession GstWhipSinkSession;
+
+/* One WHIP session, i.e. one webrtcbin and one resource on the WHIP server.
+ * All the sessions of an element share its SoupSession and ICE servers */
+struct _GstWhipSinkSession
+{
+  gint ref_count;
+  /* set once the webrtcbin of the session is gone */
+  gint removed;
+  GstWhipSink *whipsink;
+  guint id;
+  GstElement *webrtcbin;
+  gchar *whip_endpoint;
+  gchar *resource_url;
+  GstWhipSignallingState signalling_state;
+  guint n_pads;
+  /* ports of the local host UDP candidates, to find the sockets in
+   * /proc/net/udp */
+  GArray *local_ports;
+};
+
+struct _GstWhipSinkPad
+{
+  GstGhostPad parent;
+  GstWhipSinkSession *session;
+  GstWebRTCPriorityType priority;
+  gboolean priority_set;
+  GstPad *webrtcbin_pad;
+
+  /* admission stage, only used when max-latency is set */
+  GstElement *queue;
+  GstClockTime max_latency;
+  gboolean is_video;
+  gboolean have_rtptime;
+  guint32 last_rtptime;
+  gboolean drop_frame;
+  gboolean wait_keyframe;
+  gboolean keyframe_coming;
+  gboolean seen_delta;
+  gint64 last_keyframe_request;
+  guint16 seqnum_offset;
+  guint64 dropped_frames;
+  guint64 dropped_buffers;
+  guint64 keyframe_requests;
+};
+
+struct _GstWhipSinkPadClass
+{
+  GstGhostPadClass parent_class;
+};
+
 struct _GstWhipSink
 {
   GstBin parent;
   GstElement *webrtcbin;
   SoupSession *soup_session;
-  char *resource_url;
+  GHashTable *sessions;
+  guint next_session_id;
+  gchar *link_header;
   GMutex state_lock;
   GMutex lock;
   gchar *whip_endpoint;
   gboolean use_link_headers;
   gboolean do_async;
   GstWebRTCSessionDescription *offer;
+  GstCaps *codec_preferences;
+  GstWebRTCPriorityType audio_priority;
+  GstWebRTCPriorityType video_priority;
+  guint max_latency;
+  guint min_rtp_port;
+  guint max_rtp_port;
+  gboolean ice_tcp;
+  guint send_buffer_size;
+  guint receive_buffer_size;
 };
 
 struct _GstWhipSinkClass
@@ -60,6 +129,7 @@ struct _GstWhipSinkClass
 };
 
 GType gst_whip_sink_get_type (void);
+GType gst_whip_sink_pad_get_type (void);
 
 G_END_DECLS
 #endif /*  __GST_WHIP_SINK_H__  */
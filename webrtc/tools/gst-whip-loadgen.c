@@ -0,0 +1,531 @@
+/* GStreamer
+ * Copyright (C) 2022 Taruntej Kanakamalla <taruntej@asymptotic.io>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * gst-whip-loadgen: starts a number of whipsink publishers against a WHIP
+ * endpoint to measure its ingest capacity and to look for leaks in whipsink.
+ *
+ * The video is encoded once before the run and the same encoded frames are
+ * replayed to every session, so the CPU cost measured is the one of
+ * payloading, whipsink and webrtcbin, not the one of the encoder.
+ *
+ * e.g.: gst-whip-loadgen -e http://localhost:7080/whip/endpoint/abc123 \
+ *           --sessions 50 --ramp-rate 5 --duration 20 --churn 3
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+
+#define GST_USE_UNSTABLE_API
+#include <gst/webrtc/webrtc.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+typedef struct _LoadSession LoadSession;
+
+struct _LoadSession
+{
+  guint id;
+  guint cycle;
+  GstElement *pipeline;
+  GstElement *appsrc;
+  guint frame;
+  gint64 start_time;
+  gboolean connected;
+  gboolean finished;
+  guint timeout_id;
+  guint bus_watch_id;
+};
+
+/* Identifies the connection attempt a connection-state change belongs to,
+ * the webrtcbin of a previous cycle may still be tearing down */
+typedef struct
+{
+  LoadSession *session;
+  guint cycle;
+} CycleData;
+
+/* options */
+static gchar *endpoint = NULL;
+static gint n_sessions = 10;
+static gdouble ramp_rate = 5.0;
+static gint duration = 30;
+static gint churn = 1;
+static gint setup_timeout = 10;
+static gint fps = 30;
+static gint bitrate = 1000;
+static gint width = 1280;
+static gint height = 720;
+
+static GOptionEntry entries[] = {
+  {"endpoint", 'e', 0, G_OPTION_ARG_STRING, &endpoint,
+      "WHIP endpoint to publish to", "URL"},
+  {"sessions", 'n', 0, G_OPTION_ARG_INT, &n_sessions,
+      "Number of concurrent publishers (default: 10)", "N"},
+  {"ramp-rate", 'r', 0, G_OPTION_ARG_DOUBLE, &ramp_rate,
+      "Publishers started per second (default: 5)", "RATE"},
+  {"duration", 'd', 0, G_OPTION_ARG_INT, &duration,
+      "Seconds each publisher stays connected (default: 30)", "SECONDS"},
+  {"churn", 'c', 0, G_OPTION_ARG_INT, &churn,
+      "Connect/disconnect cycles per publisher (default: 1)", "CYCLES"},
+  {"timeout", 't', 0, G_OPTION_ARG_INT, &setup_timeout,
+      "Seconds before a connection attempt counts as failed (default: 10)",
+      "SECONDS"},
+  {"fps", 0, 0, G_OPTION_ARG_INT, &fps,
+      "Frame rate of the synthetic video (default: 30)", "FPS"},
+  {"bitrate", 'b', 0, G_OPTION_ARG_INT, &bitrate,
+      "Bitrate of the synthetic video in kbit/s (default: 1000)", "KBPS"},
+  {"width", 0, 0, G_OPTION_ARG_INT, &width,
+      "Width of the synthetic video (default: 1280)", "PIXELS"},
+  {"height", 0, 0, G_OPTION_ARG_INT, &height,
+      "Height of the synthetic video (default: 720)", "PIXELS"},
+  {NULL}
+};
+
+static GMainLoop *loop;
+static GPtrArray *frames;
+static GstCaps *frame_caps;
+static LoadSession *sessions;
+static guint n_started = 0;
+static guint n_finished = 0;
+static guint n_active = 0;
+static guint n_attempts = 0;
+static guint n_successes = 0;
+static GArray *setup_latencies;
+static gint64 run_start_time;
+static gdouble run_start_cpu;
+static gsize start_rss;
+static GThreadPool *teardown_pool;
+
+static void session_start (LoadSession * session);
+
+static gsize
+get_rss (void)
+{
+  gchar *statm = NULL;
+  gsize rss = 0;
+
+  if (g_file_get_contents ("/proc/self/statm", &statm, NULL, NULL)) {
+    gchar **fields = g_strsplit (statm, " ", -1);
+    if (fields[0] && fields[1])
+      rss = g_ascii_strtoull (fields[1], NULL, 10) * sysconf (_SC_PAGESIZE);
+    g_strfreev (fields);
+    g_free (statm);
+  }
+
+  return rss;
+}
+
+/* Encode a few seconds of video once, the frames get replayed to all the
+ * sessions */
+static gboolean
+encode_frames (void)
+{
+  GstElement *pipeline, *appsink;
+  GError *error = NULL;
+  GstSample *sample;
+  gchar *desc;
+
+  desc = g_strdup_printf ("videotestsrc num-buffers=%d pattern=ball ! "
+      "video/x-raw,width=%d,height=%d,framerate=%d/1 ! videoconvert ! "
+      "vp8enc deadline=1 target-bitrate=%d keyframe-max-dist=%d ! "
+      "appsink name=sink sync=false", fps * 10, width, height, fps,
+      bitrate * 1000, fps * 2);
+  pipeline = gst_parse_launch (desc, &error);
+  g_free (desc);
+  if (error) {
+    g_printerr ("Failed to create the encoding pipeline: %s\n",
+        error->message);
+    g_clear_error (&error);
+    gst_clear_object (&pipeline);
+    return FALSE;
+  }
+
+  appsink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  frames = g_ptr_array_new_with_free_func ((GDestroyNotify) gst_buffer_unref);
+  while ((sample = gst_app_sink_pull_sample (GST_APP_SINK (appsink)))) {
+    if (frame_caps == NULL)
+      frame_caps = gst_caps_ref (gst_sample_get_caps (sample));
+    g_ptr_array_add (frames, gst_buffer_ref (gst_sample_get_buffer (sample)));
+    gst_sample_unref (sample);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (appsink);
+  gst_object_unref (pipeline);
+
+  g_print ("Encoded %u frames\n", frames->len);
+
+  return frames->len > 0 && frame_caps != NULL;
+}
+
+static gboolean
+session_restart (gpointer user_data)
+{
+  session_start (user_data);
+  return G_SOURCE_REMOVE;
+}
+
+static gdouble
+get_cpu_time (struct rusage *usage)
+{
+  getrusage (RUSAGE_SELF, usage);
+  return usage->ru_utime.tv_sec + usage->ru_utime.tv_usec / 1e6 +
+      usage->ru_stime.tv_sec + usage->ru_stime.tv_usec / 1e6;
+}
+
+static void
+print_report (void)
+{
+  struct rusage usage;
+  gdouble elapsed, cpu;
+
+  elapsed =
+      (g_get_monotonic_time () - run_start_time) / (gdouble) G_USEC_PER_SEC;
+  //leave out the encoding of the frames before the run
+  cpu = get_cpu_time (&usage) - run_start_cpu;
+
+  g_print ("\n");
+  g_print ("attempts:      %u\n", n_attempts);
+  g_print ("successes:     %u (%.1f%%)\n", n_successes,
+      n_attempts ? 100.0 * n_successes / n_attempts : 0.0);
+
+  if (setup_latencies->len > 0) {
+    gdouble *l = (gdouble *) setup_latencies->data;
+    guint n = setup_latencies->len;
+
+    g_print ("setup latency: min %.1f ms, p50 %.1f ms, p90 %.1f ms, "
+        "p99 %.1f ms, max %.1f ms\n", l[0], l[n / 2], l[n * 9 / 10],
+        l[n * 99 / 100], l[n - 1]);
+  }
+
+  g_print ("cpu:           %.1f s over %.1f s (%.1f%% of a core)\n", cpu,
+      elapsed, elapsed > 0 ? 100.0 * cpu / elapsed : 0.0);
+  g_print ("rss:           %" G_GSIZE_FORMAT " kB at start, %" G_GSIZE_FORMAT
+      " kB at end, %ld kB peak\n", start_rss / 1024, get_rss () / 1024,
+      usage.ru_maxrss);
+}
+
+static gint
+compare_latency (gconstpointer a, gconstpointer b)
+{
+  gdouble la = *(const gdouble *) a, lb = *(const gdouble *) b;
+
+  return la < lb ? -1 : la > lb ? 1 : 0;
+}
+
+/* Stopping whipsink DELETEs the resource on the WHIP server, which blocks,
+ * so pipelines are torn down away from the main loop pushing the frames */
+static void
+teardown_pipeline (gpointer data, gpointer user_data)
+{
+  GstElement *pipeline = data;
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+static void
+session_stop (LoadSession * session)
+{
+  if (session->pipeline == NULL)
+    return;
+
+  if (session->timeout_id)
+    g_source_remove (session->timeout_id);
+  session->timeout_id = 0;
+  if (session->bus_watch_id)
+    g_source_remove (session->bus_watch_id);
+  session->bus_watch_id = 0;
+
+  gst_clear_object (&session->appsrc);
+  g_thread_pool_push (teardown_pool, session->pipeline, NULL);
+  session->pipeline = NULL;
+  n_active--;
+
+  session->cycle++;
+  if (session->cycle < (guint) churn) {
+    g_timeout_add (100, session_restart, session);
+    return;
+  }
+
+  session->finished = TRUE;
+  n_finished++;
+  if (n_finished == (guint) n_sessions)
+    g_main_loop_quit (loop);
+}
+
+static gboolean
+session_stop_cb (gpointer user_data)
+{
+  LoadSession *session = user_data;
+
+  session->timeout_id = 0;
+  if (!session->connected)
+    g_printerr ("session %u: connection timed out\n", session->id);
+  session_stop (session);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+session_connected_cb (gpointer user_data)
+{
+  CycleData *data = user_data;
+  LoadSession *session = data->session;
+  gdouble latency;
+
+  if (session->pipeline == NULL || session->cycle != data->cycle ||
+      session->connected)
+    return G_SOURCE_REMOVE;
+
+  session->connected = TRUE;
+  n_successes++;
+  latency = (g_get_monotonic_time () - session->start_time) / 1000.0;
+  g_array_append_val (setup_latencies, latency);
+
+  /* stay connected for the requested duration */
+  g_source_remove (session->timeout_id);
+  session->timeout_id = g_timeout_add_seconds (duration, session_stop_cb,
+      session);
+
+  return G_SOURCE_REMOVE;
+}
+
+static gboolean
+session_failed_cb (gpointer user_data)
+{
+  CycleData *data = user_data;
+  LoadSession *session = data->session;
+
+  if (session->pipeline == NULL || session->cycle != data->cycle)
+    return G_SOURCE_REMOVE;
+
+  g_printerr ("session %u: connection failed\n", session->id);
+  session_stop (session);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* called from the webrtcbin thread */
+static void
+on_connection_state (GstElement * webrtcbin, GParamSpec * pspec,
+    CycleData * data)
+{
+  GstWebRTCPeerConnectionState state;
+  GSourceFunc func;
+  CycleData *copy;
+
+  g_object_get (webrtcbin, "connection-state", &state, NULL);
+  if (state == GST_WEBRTC_PEER_CONNECTION_STATE_CONNECTED)
+    func = session_connected_cb;
+  else if (state == GST_WEBRTC_PEER_CONNECTION_STATE_FAILED)
+    func = session_failed_cb;
+  else
+    return;
+
+  copy = g_new (CycleData, 1);
+  *copy = *data;
+  g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT, func, copy, g_free);
+}
+
+static gboolean
+on_bus_message (GstBus * bus, GstMessage * msg, gpointer user_data)
+{
+  LoadSession *session = user_data;
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    GError *error = NULL;
+
+    gst_message_parse_error (msg, &error, NULL);
+    g_printerr ("session %u: %s\n", session->id, error->message);
+    g_clear_error (&error);
+    session->bus_watch_id = 0;
+    session_stop (session);
+    return G_SOURCE_REMOVE;
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+session_start (LoadSession * session)
+{
+  GstElement *pay, *whipsink, *webrtcbin;
+  CycleData *data;
+  GstBus *bus;
+
+  session->pipeline = gst_pipeline_new (NULL);
+  session->appsrc = gst_element_factory_make ("appsrc", NULL);
+  pay = gst_element_factory_make ("rtpvp8pay", NULL);
+  whipsink = gst_element_factory_make ("whipsink", NULL);
+  if (!session->appsrc || !pay || !whipsink) {
+    g_printerr ("Missing appsrc, rtpvp8pay or whipsink\n");
+    exit (1);
+  }
+  gst_object_ref (session->appsrc);
+
+  g_object_set (session->appsrc, "caps", frame_caps, "format", GST_FORMAT_TIME,
+      "is-live", TRUE, "do-timestamp", TRUE, NULL);
+  g_object_set (whipsink, "whip-endpoint", endpoint, NULL);
+  gst_bin_add_many (GST_BIN (session->pipeline), session->appsrc, pay,
+      whipsink, NULL);
+  gst_element_link_many (session->appsrc, pay, whipsink, NULL);
+
+  data = g_new0 (CycleData, 1);
+  data->session = session;
+  data->cycle = session->cycle;
+  webrtcbin = gst_bin_get_by_name (GST_BIN (whipsink), "whip-webrtcbin");
+  g_signal_connect_data (webrtcbin, "notify::connection-state",
+      G_CALLBACK (on_connection_state), data, (GClosureNotify) g_free, 0);
+  gst_object_unref (webrtcbin);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (session->pipeline));
+  session->bus_watch_id = gst_bus_add_watch (bus, on_bus_message, session);
+  gst_object_unref (bus);
+
+  session->frame = 0;
+  session->connected = FALSE;
+  session->start_time = g_get_monotonic_time ();
+  session->timeout_id = g_timeout_add_seconds (setup_timeout,
+      session_stop_cb, session);
+  n_attempts++;
+  n_active++;
+
+  gst_element_set_state (session->pipeline, GST_STATE_PLAYING);
+}
+
+static gboolean
+ramp_cb (gpointer user_data)
+{
+  session_start (&sessions[n_started]);
+  n_started++;
+
+  return n_started < (guint) n_sessions ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
+
+/* Push the next frame to every running session, a buffer copy only
+ * references the encoded memory */
+static gboolean
+tick_cb (gpointer user_data)
+{
+  gint i;
+
+  for (i = 0; i < n_sessions; i++) {
+    LoadSession *session = &sessions[i];
+    GstBuffer *buf;
+
+    if (session->appsrc == NULL)
+      continue;
+
+    buf = gst_buffer_copy (g_ptr_array_index (frames,
+            session->frame % frames->len));
+    GST_BUFFER_PTS (buf) = GST_CLOCK_TIME_NONE;
+    GST_BUFFER_DTS (buf) = GST_CLOCK_TIME_NONE;
+    gst_app_src_push_buffer (GST_APP_SRC (session->appsrc), buf);
+    session->frame++;
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gboolean
+progress_cb (gpointer user_data)
+{
+  g_print ("started %u, active %u, finished %u, connected %u/%u, "
+      "rss %" G_GSIZE_FORMAT " kB\n", n_started, n_active, n_finished,
+      n_successes, n_attempts, get_rss () / 1024);
+
+  return G_SOURCE_CONTINUE;
+}
+
+int
+main (int argc, char *argv[])
+{
+  GOptionContext *ctx;
+  GError *error = NULL;
+  struct rusage usage;
+  gint i;
+
+  ctx = g_option_context_new ("- WHIP ingest load generator");
+  g_option_context_add_main_entries (ctx, entries, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("Error initializing: %s\n", error->message);
+    g_clear_error (&error);
+    g_option_context_free (ctx);
+    return 1;
+  }
+  g_option_context_free (ctx);
+
+  if (endpoint == NULL) {
+    g_printerr ("An endpoint is required, see --help\n");
+    return 1;
+  }
+  if (n_sessions < 1 || ramp_rate <= 0 || churn < 1 || fps < 1) {
+    g_printerr ("Invalid sessions, ramp-rate, churn or fps\n");
+    return 1;
+  }
+
+  if (!encode_frames ())
+    return 1;
+
+  loop = g_main_loop_new (NULL, FALSE);
+  teardown_pool = g_thread_pool_new (teardown_pipeline, NULL, -1, FALSE, NULL);
+  setup_latencies = g_array_new (FALSE, FALSE, sizeof (gdouble));
+  sessions = g_new0 (LoadSession, n_sessions);
+  for (i = 0; i < n_sessions; i++)
+    sessions[i].id = i;
+
+  start_rss = get_rss ();
+  run_start_time = g_get_monotonic_time ();
+  run_start_cpu = get_cpu_time (&usage);
+
+  ramp_cb (NULL);
+  if (n_sessions > 1)
+    g_timeout_add ((guint) (1000 / ramp_rate), ramp_cb, NULL);
+  g_timeout_add (1000 / fps, tick_cb, NULL);
+  g_timeout_add_seconds (5, progress_cb, NULL);
+
+  g_main_loop_run (loop);
+
+  //wait for the last DELETEs before reporting
+  g_thread_pool_free (teardown_pool, FALSE, TRUE);
+  g_array_sort (setup_latencies, compare_latency);
+  print_report ();
+
+  g_free (sessions);
+  g_array_unref (setup_latencies);
+  g_ptr_array_unref (frames);
+  gst_caps_unref (frame_caps);
+  g_main_loop_unref (loop);
+  g_free (endpoint);
+
+  return 0;
+}